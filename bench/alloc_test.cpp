@@ -0,0 +1,102 @@
+// Check that the EV recursion never allocates.
+//
+// EvContext allocates its caches once, up front, so that the recursive
+// search runs without touching the heap. This replaces the global
+// operator new with a counting one, builds a context, and then evaluates
+// hit and split on cold caches for several deck counts and hands; any
+// allocation counted after the context is built fails the check.
+//
+// Built outside R like bench (see bench/Makefile). Prints one line per
+// case and exits with status 1 if any case allocated.
+
+#include "blackjack.h"
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+
+static std::atomic<long> allocations(0);
+
+void* operator new(std::size_t size) {
+  allocations.fetch_add(1, std::memory_order_relaxed);
+  void* p = std::malloc(size == 0 ? 1 : size);
+  if (p == nullptr) throw std::bad_alloc();
+  return p;
+}
+
+void* operator new[](std::size_t size) {
+  return operator new(size);
+}
+
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete[](void* p) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t) noexcept { std::free(p); }
+void operator delete[](void* p, std::size_t) noexcept { std::free(p); }
+
+static const int DECK_COUNTS[] = {1, 2, 6};
+
+// Rules of the check; only the deck count varies.
+static BlackjackRules test_rules(int num_decks) {
+  BlackjackRules rules;
+  rules.dealer_stands_soft_17 = true;
+  rules.num_decks = num_decks;
+  rules.allow_insurance = true;
+  rules.dealer_peeks = true;
+  rules.double_on = DoubleRule::ANY;
+  rules.double_after_split = true;
+  rules.max_splits = 3;
+  rules.resplit_aces = false;
+  rules.hit_split_aces = false;
+  rules.payout = 1.5;
+  rules.penetration = 0.75;
+  rules.burn_cards = 1;
+  rules.surrender = SurrenderRule::LATE;
+  rules.infinite_deck = false;
+  return rules;
+}
+
+// Full shoe less the player's pair of `pair` and the dealer's `upcard`.
+static std::array<int, 12> shoe_after(int num_decks, int pair, int upcard) {
+  std::array<int, 12> counts{};
+  for (int v = 2; v <= 11; ++v) counts[v] = 4 * num_decks * (v == 10 ? 4 : 1);
+  counts[pair] -= 2;
+  counts[upcard] -= 1;
+  return counts;
+}
+
+// Evaluate hit and split of a pair against an upcard on a fresh context
+// and print the allocations made after the context was built.
+static bool check_case(int num_decks, int pair, int upcard) {
+  BlackjackRules rules = test_rules(num_decks);
+  EvContext ctx(rules, 16u << 20);
+  HandState player = empty_hand();
+  player.add(pair);
+  player.add(pair);
+  HandState dealer = empty_hand();
+  dealer.add(upcard);
+  std::array<int, 12> counts = shoe_after(num_decks, pair, upcard);
+
+  allocations.store(0);
+  double hit = eval_hit_c(dealer, player, counts, ctx);
+  double split = eval_split_c(dealer, pair, counts, ctx);
+  long n = allocations.load();
+
+  std::printf("%d decks, %d,%d vs %d: hit %.6f split %.6f, %ld allocations\n",
+              num_decks, pair, pair, upcard, hit, split, n);
+  return n == 0;
+}
+
+int main() {
+  bool ok = true;
+  for (int decks : DECK_COUNTS) {
+    ok &= check_case(decks, 8, 10);
+    ok &= check_case(decks, 2, 6);
+    ok &= check_case(decks, 11, 11);
+  }
+  if (!ok) {
+    std::printf("FAIL: the EV recursion allocated\n");
+    return 1;
+  }
+  std::printf("ok\n");
+  return 0;
+}
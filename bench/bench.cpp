@@ -0,0 +1,211 @@
+// Standalone benchmarks of the simulation and EV core.
+//
+// Built outside R against the same src/ files with BLACKJACK_STANDALONE
+// defined (see bench/Makefile). Every scenario uses fixed seeds and fixed
+// compositions, so runs of different builds measure the same work and
+// the checksum column must match between them.
+//
+// Output is CSV on stdout, one row per scenario:
+//   benchmark,decks,case,ops,seconds,ns_per_op,ops_per_sec,checksum
+// where seconds is the fastest of the repeats and ops the operations
+// timed in each repeat.
+//
+// Usage: bench [--repeats N] [--filter SUBSTRING]
+
+#include "blackjack.h"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+
+static const int DECK_COUNTS[] = {1, 2, 6, 8};
+
+// Rules used by every scenario; only the deck count varies.
+static BlackjackRules bench_rules(int num_decks) {
+  BlackjackRules rules;
+  rules.dealer_stands_soft_17 = true;
+  rules.num_decks = num_decks;
+  rules.allow_insurance = true;
+  rules.dealer_peeks = true;
+  rules.double_on = DoubleRule::ANY;
+  rules.double_after_split = true;
+  rules.max_splits = 3;
+  rules.resplit_aces = false;
+  rules.hit_split_aces = false;
+  rules.payout = 1.5;
+  rules.penetration = 0.75;
+  rules.burn_cards = 1;
+  rules.surrender = SurrenderRule::LATE;
+  rules.infinite_deck = false;
+  return rules;
+}
+
+struct BenchOptions {
+  int repeats;
+  const char* filter;
+};
+
+// Time `run` (which performs `ops` operations and returns a checksum)
+// `repeats` times and print the fastest repeat as one CSV row. `setup`,
+// if given, runs untimed before each repeat.
+static void report(const BenchOptions& options, const char* benchmark,
+                   int decks, const char* name, long ops,
+                   const std::function<double()>& run,
+                   const std::function<void()>& setup = nullptr) {
+  std::string label = std::string(benchmark) + "/" + std::to_string(decks) + "/" + name;
+  if (options.filter != nullptr && label.find(options.filter) == std::string::npos) return;
+
+  double best = 0.0;
+  double checksum = 0.0;
+  for (int r = 0; r < options.repeats; ++r) {
+    if (setup) setup();
+    auto start = std::chrono::steady_clock::now();
+    checksum = run();
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    if (r == 0 || elapsed.count() < best) best = elapsed.count();
+  }
+
+  std::printf("%s,%d,%s,%ld,%.6f,%.2f,%.1f,%.12g\n", benchmark, decks, name, ops,
+              best, best * 1e9 / ops, ops / best, checksum);
+  std::fflush(stdout);
+}
+
+// Per-call cost of evaluate_hand_c on dealt hands of 2 to 6 cards.
+static void bench_evaluate_hand(const BenchOptions& options, int decks) {
+  const int n_hands = 4096;
+  const long calls = 1L << 20;
+  std::mt19937_64 rng(7);
+  std::vector<Card> shoe = create_shoe_c(decks, rng);
+
+  std::vector<std::vector<Card>> hands(n_hands);
+  std::size_t pos = 0;
+  for (int i = 0; i < n_hands; ++i) {
+    int size = 2 + i % 5;
+    for (int c = 0; c < size; ++c) {
+      hands[i].push_back(shoe[pos]);
+      pos = (pos + 1) % shoe.size();
+    }
+  }
+
+  report(options, "evaluate_hand", decks, "mixed", calls, [&]() {
+    double sum = 0.0;
+    for (long i = 0; i < calls; ++i) {
+      HandVal value = evaluate_hand_c(hands[i % n_hands]);
+      sum += value.total + (value.soft ? 100 : 0);
+    }
+    return sum;
+  });
+}
+
+// Cost of building and shuffling a shoe with create_shoe_c.
+static void bench_create_shoe(const BenchOptions& options, int decks) {
+  const long shoes = 20000 / decks;
+  report(options, "create_shoe", decks, "shuffle", shoes, [&]() {
+    std::mt19937_64 rng(11);
+    double sum = 0.0;
+    for (long i = 0; i < shoes; ++i) sum += card_value(create_shoe_c(decks, rng)[0]);
+    return sum;
+  });
+}
+
+// Dealer rounds per second with dealer_play_c, reshuffling at the cut card.
+static void bench_dealer_play(const BenchOptions& options, int decks) {
+  const long rounds = 1000000;
+  report(options, "dealer_play", decks, "s17", rounds, [&]() {
+    Shoe shoe(decks, 0.75);
+    std::uint64_t shoe_index = 0;
+    shoe.shuffle(13, shoe_index);
+    double sum = 0.0;
+    for (long i = 0; i < rounds; ++i) {
+      if (shoe.past_cut()) shoe.shuffle(13, ++shoe_index);
+      HandState dealer = empty_hand();
+      dealer.add(card_value(shoe.draw()));
+      if (dealer_play_c<true>(shoe, dealer)) sum += dealer.total();
+    }
+    return sum;
+  });
+}
+
+// One EV query: a player hand against a dealer upcard with the given
+// cards removed from a full shoe.
+struct EvCase {
+  const char* name;
+  std::vector<int> player;
+  int upcard;
+  std::vector<int> removed;   // Extra cards gone, beyond player and dealer
+};
+
+// A deep composition: a third of the low cards and a sixth of the tens
+// already dealt, so few states are shared with the full shoe.
+static std::vector<int> deep_removal(int decks) {
+  std::vector<int> removed;
+  for (int v = 2; v <= 6; ++v) {
+    for (int i = 0; i < 4 * decks / 3; ++i) removed.push_back(v);
+  }
+  for (int i = 0; i < 16 * decks / 6; ++i) removed.push_back(10);
+  return removed;
+}
+
+// Latency of eval_stand_c, eval_hit_c and eval_double_c from a cold
+// context (caches cleared before every timed query).
+static void bench_ev(const BenchOptions& options, int decks) {
+  const BlackjackRules rules = bench_rules(decks);
+  const std::size_t cache_bytes = static_cast<std::size_t>(64) * 1024 * 1024;
+  EvContext ctx(rules, cache_bytes);
+
+  std::vector<EvCase> cases = {
+    {"hard_16_vs_10", {10, 6}, 10, {}},
+    {"hard_11_vs_6", {6, 5}, 6, {}},
+    {"soft_18_vs_9", {11, 7}, 9, {}},
+    {"hard_12_vs_2_deep", {10, 2}, 2, deep_removal(decks)},
+  };
+
+  for (const EvCase& c : cases) {
+    std::array<int, 12> counts = full_shoe_counts(decks);
+    HandState player = empty_hand();
+    for (int v : c.player) {
+      player.add(v);
+      counts[v]--;
+    }
+    HandState dealer = empty_hand();
+    dealer.add(c.upcard);
+    counts[c.upcard]--;
+    for (int v : c.removed) counts[v]--;
+
+    const char* kinds[] = {"stand", "hit", "double"};
+    for (const char* kind : kinds) {
+      std::string benchmark = std::string("eval_") + kind;
+      report(options, benchmark.c_str(), decks, c.name, 1, [&]() {
+        if (std::strcmp(kind, "stand") == 0) return eval_stand_c(dealer, player.total(), counts, ctx);
+        if (std::strcmp(kind, "hit") == 0) return eval_hit_c(dealer, player, counts, ctx);
+        return eval_double_c(dealer, player, counts, ctx);
+      }, [&]() {
+        ctx.dealer.clear();
+        ctx.table.clear();
+      });
+    }
+  }
+}
+
+int main(int argc, char** argv) {
+  BenchOptions options{5, nullptr};
+  for (int i = 1; i < argc; ++i) {
+    if (std::strcmp(argv[i], "--repeats") == 0 && i + 1 < argc) {
+      options.repeats = std::max(1, std::atoi(argv[++i]));
+    } else if (std::strcmp(argv[i], "--filter") == 0 && i + 1 < argc) {
+      options.filter = argv[++i];
+    } else {
+      std::fprintf(stderr, "usage: %s [--repeats N] [--filter SUBSTRING]\n", argv[0]);
+      return 2;
+    }
+  }
+
+  std::printf("benchmark,decks,case,ops,seconds,ns_per_op,ops_per_sec,checksum\n");
+  for (int decks : DECK_COUNTS) {
+    bench_evaluate_hand(options, decks);
+    bench_create_shoe(options, decks);
+    bench_dealer_play(options, decks);
+    bench_ev(options, decks);
+  }
+  return 0;
+}
@@ -4,16 +4,123 @@
 #include <string>
 #include <vector>
 #include <random>
+#include <array>
+#include <cstdint>
+#include <algorithm>
+#include <chrono>
+#include <functional>
+#include <fstream>
+
+// The card, shoe, dealer and EV core also builds without R (see bench/)
+// when BLACKJACK_STANDALONE is defined. The R-boundary functions are then
+// left out, and the few Rcpp calls the core makes are provided here:
+// errors throw std::runtime_error and interrupts are never requested.
+#ifdef BLACKJACK_STANDALONE
+#include <stdexcept>
+namespace Rcpp {
+inline void stop(const std::string& message) { throw std::runtime_error(message); }
+inline void checkUserInterrupt() {}
+}
+#else
 #include <Rcpp.h>
+#endif
+
+
+// Event counters of the profiling build.
+enum class ProfileCounter {
+  EV_NODES,            // Player EV states expanded (transposition misses)
+  EV_CACHE_HITS,       // Player EV states answered by the transposition table
+  DEALER_NODES,        // Dealer states expanded by dealer_dist_c
+  DEALER_CACHE_HITS,   // Dealer states answered by the dealer cache
+  DEALER_TABLE_HITS,   // Stand EVs answered by a loaded dealer table
+  SHOES_SHUFFLED,
+  CARDS_DRAWN,         // Includes burned cards; shuffling happens per draw
+  ROUNDS_PLAYED,
+  COUNT
+};
+
+// Scoped timers of the profiling build.
+enum class ProfileTimer {
+  PARSE_RULES,
+  PARSE_STRATEGY,
+  DF_TO_CARDS,
+  SHUFFLE,             // Shoe reset and reseed between shoes
+  EV_QUERY,            // get_specific_evs_rcpp / get_batch_evs_rcpp
+  STRATEGY_TABLE,
+  SIMULATE,            // All shoes of one simulation call
+  COUNT
+};
+
+const int NUM_PROFILE_COUNTERS = static_cast<int>(ProfileCounter::COUNT);
+const int NUM_PROFILE_TIMERS = static_cast<int>(ProfileTimer::COUNT);
+
+// Profile totals of one thread, or of several once merged.
+struct ProfileData {
+  std::array<std::uint64_t, NUM_PROFILE_COUNTERS> counts;
+  std::array<std::uint64_t, NUM_PROFILE_TIMERS> timer_calls;
+  std::array<std::uint64_t, NUM_PROFILE_TIMERS> timer_ns;
+};
+
+// Instrumentation is compiled in only when BLACKJACK_PROFILE is defined
+// (add -DBLACKJACK_PROFILE to PKG_CPPFLAGS in src/Makevars); otherwise
+// PROFILE_COUNT and PROFILE_SCOPE expand to nothing. Each thread counts
+// into its own ProfileData, so the hot paths never share a cache line.
+#ifdef BLACKJACK_PROFILE
+ProfileData& profile_local();
+ProfileData profile_totals(bool reset);
 
+inline void profile_count(ProfileCounter counter) {
+  profile_local().counts[static_cast<int>(counter)]++;
+}
 
-// Define structure of a card: rank, suit, and card's value
+// Adds the time from construction to destruction to a timer.
+class ProfileScope {
+public:
+  explicit ProfileScope(ProfileTimer which)
+    : timer(static_cast<int>(which)), start(std::chrono::steady_clock::now()) {}
+  ~ProfileScope() {
+    std::chrono::nanoseconds elapsed = std::chrono::steady_clock::now() - start;
+    ProfileData& data = profile_local();
+    data.timer_calls[timer]++;
+    data.timer_ns[timer] += static_cast<std::uint64_t>(elapsed.count());
+  }
+  ProfileScope(const ProfileScope&) = delete;
+  ProfileScope& operator=(const ProfileScope&) = delete;
+
+private:
+  int timer;
+  std::chrono::steady_clock::time_point start;
+};
+
+#define PROFILE_COUNT(counter) profile_count(ProfileCounter::counter)
+#define PROFILE_SCOPE(timer) ProfileScope profile_scope_(ProfileTimer::timer)
+#else
+#define PROFILE_COUNT(counter) ((void)0)
+#define PROFILE_SCOPE(timer) ((void)0)
+#endif
+
+// A playing card packed into a single byte.
+//
+// The low four bits hold the rank index (0 = A, 1-9 = 2-10, 10 = J,
+// 11 = Q, 12 = K) and the next two bits hold the suit index
+// (0 = ♠, 1 = ♥, 2 = ♦, 3 = ♣). Rank and suit strings are only produced
+// at the R boundary; everything else works on the code and the card's
+// blackjack value.
 struct Card {
-  std::string rank;
-  std::string suit;
-  int value;
+  std::uint8_t code;
 };
 
+// Blackjack point value of each rank index (Ace = 11, face cards = 10).
+constexpr int RANK_VALUE[13] = {11, 2, 3, 4, 5, 6, 7, 8, 9, 10, 10, 10, 10};
+
+inline Card make_card(int rank, int suit) {
+  return Card{static_cast<std::uint8_t>(rank | (suit << 4))};
+}
+
+inline int card_rank(Card card) { return card.code & 0x0F; }
+inline int card_suit(Card card) { return card.code >> 4; }
+inline int card_value(Card card) { return RANK_VALUE[card.code & 0x0F]; }
+
 // Represents the evaluated value of a blackjack hand.
 //
 // Fields:
@@ -33,6 +140,51 @@ struct HandVal {
   std::string code;
 };
 
+// Incrementally maintained state of a blackjack hand.
+//
+// Adding a card is O(1), so the dealer loop and the EV recursion never
+// re-walk a card vector. At most one Ace can count as 11 without busting,
+// so the best total follows from the hard total and the Ace count alone.
+//
+// Fields:
+//   hard_total  - Sum of the card values with every Ace counted as 1.
+//   aces        - Number of Aces in the hand.
+//   num_cards   - Number of cards in the hand.
+//   first_value - Value of the first card, used to detect pairs.
+//   pair        - True if the hand is exactly two cards of equal value.
+struct HandState {
+  std::uint8_t hard_total;
+  std::uint8_t aces;
+  std::uint8_t num_cards;
+  std::uint8_t first_value;
+  bool pair;
+
+  // Add a card of blackjack value `value` (2-11) to the hand.
+  void add(int value) {
+    hard_total += (value == 11) ? 1 : value;
+    if (value == 11) ++aces;
+    if (num_cards == 0) first_value = value;
+    ++num_cards;
+    pair = (num_cards == 2 && first_value == value);
+  }
+
+  // True if an Ace is being counted as 11.
+  bool soft() const { return aces > 0 && hard_total + 10 <= 21; }
+
+  // The best blackjack total for the hand.
+  int total() const { return soft() ? hard_total + 10 : hard_total; }
+
+  // True for a two-card 21.
+  bool blackjack() const { return num_cards == 2 && aces == 1 && hard_total == 11; }
+
+  // A short display code such as "S17" or "H12".
+  std::string code() const { return (soft() ? "S" : "H") + std::to_string(total()); }
+};
+
+inline HandState empty_hand() {
+  return HandState{0, 0, 0, 0, false};
+}
+
 // Rules governing when a player may double down.
 enum class DoubleRule {
   ANY,          // Double on any two cards
@@ -40,6 +192,13 @@ enum class DoubleRule {
   TEN_ELEVEN    // Double only on hard 10 or 11
 };
 
+// Rules governing when a player may surrender half the bet.
+enum class SurrenderRule {
+  NONE,   // Surrender not offered
+  EARLY,  // Surrender before the dealer checks for blackjack
+  LATE    // Surrender only after the dealer checks for blackjack
+};
+
 // Blackjack table rules and configuration.
 struct BlackjackRules {
   bool dealer_stands_soft_17;   // True if dealer stands on soft 17 (S17), false if hits (H17)
@@ -51,23 +210,774 @@ struct BlackjackRules {
   int max_splits;               // Maximum number of splits allowed in a round
   bool resplit_aces;            // Whether aces may be resplit if another ace is drawn
   bool hit_split_aces;          // Whether the player may hit hands formed by split aces
+  double payout;                // Payout ratio for a natural blackjack (1.5 for 3:2)
+  double penetration;           // Fraction of the shoe dealt before reshuffling
+  int burn_cards;               // Cards discarded from the top after a shuffle
+  SurrenderRule surrender;      // When (if ever) the player may surrender
+  bool infinite_deck;           // EV queries draw from an infinite deck instead of card_counts
 };
 
+// True if a dealer holding `total` (21 or less) stands under S17 or H17.
+template <bool S17>
+constexpr bool dealer_stands(int total, bool soft) {
+  return total > 17 || (total == 17 && (S17 || !soft));
+}
+
+// Table rules fixed at compile time.
+//
+// The rules consulted inside the dealer, EV and simulation loops are
+// template parameters, so each instantiation tests constants and the
+// compiler drops the branches that cannot be taken. Rules only read once
+// per round or query (payout, split limits, surrender, ...) stay in
+// BlackjackRules. Use dispatch_rules to pick the instantiation.
+template <bool S17, bool DAS, bool HSA, DoubleRule DOUBLE_ON>
+struct RuleSet {
+  static constexpr bool dealer_stands_soft_17 = S17;
+  static constexpr bool double_after_split = DAS;
+  static constexpr bool hit_split_aces = HSA;
+  static constexpr DoubleRule double_on = DOUBLE_ON;
+
+  // Same as can_double_c under these rules.
+  static bool can_double(const HandState& hand, bool split_hand) {
+    if (hand.num_cards != 2) return false;
+    if (!DAS && split_hand) return false;
+    if (DOUBLE_ON == DoubleRule::ANY) return true;
+
+    int total = hand.total();
+    if (hand.soft()) return false;
+    if (DOUBLE_ON == DoubleRule::NINE_TEN_ELEVEN) return total >= 9 && total <= 11;
+    return total == 10 || total == 11;
+  }
+
+  // Same as can_hit_c under these rules.
+  static constexpr bool can_hit(bool split_aces) { return HSA || !split_aces; }
+};
+
+template <bool S17, bool DAS, bool HSA, class F>
+auto dispatch_double_rule(DoubleRule double_on, F&& f) {
+  switch (double_on) {
+    case DoubleRule::NINE_TEN_ELEVEN:
+      return f(RuleSet<S17, DAS, HSA, DoubleRule::NINE_TEN_ELEVEN>());
+    case DoubleRule::TEN_ELEVEN:
+      return f(RuleSet<S17, DAS, HSA, DoubleRule::TEN_ELEVEN>());
+    default:
+      return f(RuleSet<S17, DAS, HSA, DoubleRule::ANY>());
+  }
+}
+
+template <bool S17, bool DAS, class F>
+auto dispatch_hit_split_aces(const BlackjackRules& rules, F&& f) {
+  if (rules.hit_split_aces) return dispatch_double_rule<S17, DAS, true>(rules.double_on, f);
+  return dispatch_double_rule<S17, DAS, false>(rules.double_on, f);
+}
+
+template <bool S17, class F>
+auto dispatch_double_after_split(const BlackjackRules& rules, F&& f) {
+  if (rules.double_after_split) return dispatch_hit_split_aces<S17, true>(rules, f);
+  return dispatch_hit_split_aces<S17, false>(rules, f);
+}
+
+// Call `f` with the RuleSet matching `rules`, e.g.
+//
+//   dispatch_rules(rules, [&](auto rule_set) {
+//     using R = decltype(rule_set);
+//     ...
+//   });
+//
+// The choice is made once per call; every instantiation of `f` must
+// return the same type.
+template <class F>
+auto dispatch_rules(const BlackjackRules& rules, F&& f) {
+  if (rules.dealer_stands_soft_17) return dispatch_double_after_split<true>(rules, f);
+  return dispatch_double_after_split<false>(rules, f);
+}
+
+// Player actions. The numeric values are the codes used in strategy tables.
+enum class Action {
+  STAND = 0,
+  HIT = 1,
+  DOUBLE = 2,
+  SPLIT = 3,
+  SURRENDER = 4
+};
+
+// Number of hand classes (rows) in a strategy table:
+//   rows  0-17 - hard totals 4-21
+//   rows 18-27 - soft totals 12-21
+//   rows 28-37 - pairs of 2s through pairs of Aces (by card value)
+const int NUM_HAND_CLASSES = 38;
+
+// A playing strategy: one action for every hand class against each dealer
+// upcard, optionally varying with the Hi-Lo true count.
+//
+// Each cell byte holds an Action code in its low four bits. For doubling
+// and surrender cells the high four bits hold the action to take when the
+// primary one is not allowed (e.g. double, else stand), stored as the
+// Action code plus one; zero means "hit". Cells are laid out as
+// `actions[(bin * NUM_HAND_CLASSES + hand_class) * 10 + (upcard - 2)]`.
+// With n_bins > 1, bin b covers true counts in
+// [tc_breaks[b - 1], tc_breaks[b]), with open ends for the first and last
+// bins.
+struct Strategy {
+  std::vector<std::uint8_t> actions;
+  std::vector<double> tc_breaks;  // n_bins - 1 ascending break points
+  int n_bins;
+
+  // True-count bin for true count `tc`.
+  int bin(double tc) const {
+    return static_cast<int>(std::upper_bound(tc_breaks.begin(), tc_breaks.end(), tc) -
+                            tc_breaks.begin());
+  }
+
+  // Cell of `hand_class` against `upcard` (2-11) in true-count bin `bin`.
+  std::uint8_t cell(int hand_class, int upcard, int bin) const {
+    return actions[(bin * NUM_HAND_CLASSES + hand_class) * 10 + (upcard - 2)];
+  }
+};
+
+// Primary action of a strategy cell.
+inline Action cell_action(std::uint8_t cell) {
+  return static_cast<Action>(cell & 0x0F);
+}
+
+// Action to take when a cell's double or surrender is not allowed.
+inline Action cell_fallback(std::uint8_t cell) {
+  return (cell >> 4) ? static_cast<Action>((cell >> 4) - 1) : Action::HIT;
+}
+
+// Encode a strategy cell.
+inline std::uint8_t make_cell(Action action, Action fallback) {
+  return static_cast<std::uint8_t>(static_cast<int>(action) |
+                                   ((static_cast<int>(fallback) + 1) << 4));
+}
+
+// EVs of each action for one strategy-table cell (hand class against a
+// dealer upcard). NaN marks an action that is not available.
+struct CellEvs {
+  double stand;
+  double hit;
+  double dbl;
+  double surrender;
+  double split;
+};
+
+// Maximum number of player hands in a round (one more than the largest
+// supported max_splits).
+const int MAX_HANDS = 8;
+
+// Probability distribution over the dealer's final outcome.
+//
+// Fields:
+//   p - p[0] through p[4] are the probabilities that the dealer finishes
+//       on 17, 18, 19, 20 and 21; p[5] is the probability the dealer busts.
+struct DealerDist {
+  std::array<double, 6> p;
+};
+
+// Number of dealer hands dealer_dist_lanes_c evaluates together: the ten
+// upcards, padded to a multiple of four doubles for AVX2.
+const int DEALER_LANES = 12;
+
+// Input of the lane-parallel dealer kernel, one dealer hand per lane.
+//
+// Fields:
+//   p      - p[v - 2][lane] is the probability the lane's dealer draws a
+//            card of value v (2-11).
+//   upcard - Upcard value (2-11) of each lane, or 0 for an unused lane.
+//   s17    - True if the dealer stands on soft 17.
+struct DealerLanes {
+  alignas(32) double p[10][DEALER_LANES];
+  int upcard[DEALER_LANES];
+  bool s17;
+};
+
+// Largest number of decks a DealerKey can represent: 63 decks hold 252
+// cards of each non-ten value, the most an 8-bit count can hold.
+const int MAX_DECKS = 63;
+
+// Key identifying a dealer hand state together with the remaining shoe.
+//
+// The remaining counts of 2-9 are packed 8 bits each into `lo`; `hi` holds
+// the count of tens (16 bits), the count of aces (8 bits), the dealer's
+// total and the soft flag. Two states with equal keys always produce the
+// same dealer distribution, no matter the order in which cards were drawn.
+struct DealerKey {
+  std::uint64_t lo;
+  std::uint64_t hi;
+
+  bool operator==(const DealerKey& other) const {
+    return lo == other.lo && hi == other.hi;
+  }
+};
+
+struct DealerKeyHash {
+  std::size_t operator()(const DealerKey& key) const {
+    std::uint64_t h = key.lo * 0x9E3779B97F4A7C15ULL;
+    h ^= key.hi + 0x7F4A7C159E3779B9ULL + (h << 6) + (h >> 2);
+    // Fold the high bits down: FixedHashTable indexes by the low bits,
+    // and the dealer total and soft flag sit high in `hi`
+    h ^= h >> 31;
+    h *= 0xBF58476D1CE4E5B9ULL;
+    h ^= h >> 29;
+    return static_cast<std::size_t>(h);
+  }
+};
+
+// Fixed-size hash table keyed by DealerKey.
+//
+// All memory is allocated once, at construction, so lookups and stores
+// never allocate; a colliding store simply replaces the older entry, so a
+// full table only costs recomputation, never correctness. Every key the
+// EV code stores has a non-zero `hi` word, so an all-zero key marks an
+// empty slot.
+template <class V>
+class FixedHashTable {
+public:
+  // Use at most `max_bytes`, rounded down to a power-of-two entry count.
+  explicit FixedHashTable(std::size_t max_bytes) {
+    std::size_t n = 1;
+    while (n * 2 * sizeof(Entry) <= max_bytes) n *= 2;
+    entries.assign(n, Entry());
+    mask = n - 1;
+  }
+
+  // Returns true and sets `value` if `key` is present.
+  bool probe(const DealerKey& key, V& value) const {
+    const Entry& e = entries[DealerKeyHash()(key) & mask];
+    if (e.key == key) {
+      value = e.value;
+      return true;
+    }
+    return false;
+  }
+
+  // Store a value, replacing whatever occupied the slot.
+  void store(const DealerKey& key, const V& value) {
+    Entry& e = entries[DealerKeyHash()(key) & mask];
+    e.key = key;
+    e.value = value;
+  }
+
+  // Drop all entries without releasing memory.
+  void clear() { std::fill(entries.begin(), entries.end(), Entry()); }
+
+  std::size_t memory_bytes() const { return entries.size() * sizeof(Entry); }
+
+private:
+  struct Entry {
+    DealerKey key;
+    V value;
+
+    Entry() : key(DealerKey{0, 0}), value() {}
+  };
+
+  std::vector<Entry> entries;
+  std::size_t mask;
+};
+
+// Memo table of dealer distributions keyed by dealer state and remaining
+// shoe.
+typedef FixedHashTable<DealerDist> DealerCache;
+
+// Kinds of player EV stored in the transposition table.
+enum class EvKind {
+  STAND = 1,
+  HIT = 2,
+  DOUBLE = 3
+};
+
+// Hash table of player EVs keyed by (action, player state, dealer state,
+// remaining shoe). The recursive hit search reaches the same state
+// through many different draw orders; the table lets each one be
+// expanded once.
+typedef FixedHashTable<double> TranspositionTable;
+
+// A read-only file held in memory for the life of the object.
+//
+// POSIX systems map the file, so opening it costs no reading and the
+// pages are shared between R sessions. Elsewhere the file is read into
+// memory instead.
+class MappedFile {
+public:
+  // Map the file at `path`; stops with an R error naming it as a `what`
+  // if it cannot be opened.
+  MappedFile(const std::string& path, const std::string& what);
+  ~MappedFile();
+  MappedFile(const MappedFile&) = delete;
+  MappedFile& operator=(const MappedFile&) = delete;
+
+  const unsigned char* data() const { return start; }
+  std::size_t size() const { return bytes; }
+
+private:
+  const unsigned char* start;
+  std::size_t bytes;
+  void* mapping;                      // Start of the mapped file
+  std::vector<unsigned char> buffer;  // File contents where mmap is unavailable
+};
+
+// Version of the dealer table file format; bump on any layout change.
+const std::uint32_t DEALER_TABLE_VERSION = 1;
+
+// Header of a dealer table file.
+//
+// The file is the header followed by `count` DealerTableEntry records
+// sorted by (key.hi, key.lo). Values are stored in the writer's native
+// byte order; `byte_order` lets a reader on another platform reject it.
+struct DealerTableHeader {
+  char magic[8];             // "BJDEALER"
+  std::uint32_t version;     // DEALER_TABLE_VERSION
+  std::uint32_t byte_order;  // 0x01020304 as written
+  std::uint32_t dealer_stands_soft_17;
+  std::uint32_t num_decks;
+  std::uint32_t max_removed; // Largest removal set enumerated
+  std::uint32_t reserved;
+  std::uint64_t count;       // Number of entries
+};
+
+// One precomputed dealer distribution.
+struct DealerTableEntry {
+  DealerKey key;
+  DealerDist dist;
+};
+
+// A read-only dealer table file, memory-mapped for the life of the object.
+//
+// Dealer distributions depend only on the dealer state, the remaining
+// composition and the soft 17 rule, all of which are in the key or the
+// header, so a lookup hit is exactly what dealer_dist_c would compute.
+class DealerTable {
+public:
+  // Map the file at `path`; stops with an R error if it is not a valid
+  // table of the current version.
+  explicit DealerTable(const std::string& path);
+  DealerTable(const DealerTable&) = delete;
+  DealerTable& operator=(const DealerTable&) = delete;
+
+  // Returns true and sets `dist` if `key` is in the table.
+  bool find(const DealerKey& key, DealerDist& dist) const;
+
+  const DealerTableHeader& header() const { return *head; }
+
+private:
+  MappedFile file;
+  const DealerTableHeader* head;
+  const DealerTableEntry* entries;
+};
+
+// State shared by the recursive EV functions during a query.
+//
+// Fields:
+//   rules        - Table rules the cached values were computed under.
+//   dealer       - Dealer distribution memo table.
+//   table        - Transposition table of stand/hit/double EVs.
+//   dealer_table - Loaded dealer table matching the rules, or null.
+//   dealer_peeked - Whether the dealer has already checked for a natural,
+//                   so a lone Ace or ten upcard is known not to have one
+//                   (applied to the dealer's outcome at each stand only).
+//                   Set before the first query; cached EVs assume it.
+struct EvContext {
+  BlackjackRules rules;
+  DealerCache dealer;
+  TranspositionTable table;
+  const DealerTable* dealer_table;
+  bool dealer_peeked;
+
+  EvContext(const BlackjackRules& rules, std::size_t max_bytes);
+};
+
+
+// Counter-based random number generator (Philox4x32-10).
+//
+// Output block i of stream `stream` is a pure function of (seed, stream, i),
+// so any stream can be regenerated without replaying the ones before it.
+// Shoe k of a simulation uses stream k, which lets a run be split across
+// processes by shoe range, resumed, or have a single shoe replayed.
+class PhiloxRng {
+public:
+  PhiloxRng(std::uint64_t seed, std::uint64_t stream)
+    : key0(static_cast<std::uint32_t>(seed)),
+      key1(static_cast<std::uint32_t>(seed >> 32)),
+      stream(stream), block(0), used(4) {}
+
+  // Next uniformly distributed 32-bit value.
+  std::uint32_t next() {
+    if (used == 4) refill();
+    return out[used++];
+  }
+
+  // Uniform integer in [0, n) without modulo bias (Lemire's method).
+  std::uint32_t bounded(std::uint32_t n) {
+    std::uint64_t m = static_cast<std::uint64_t>(next()) * n;
+    std::uint32_t low = static_cast<std::uint32_t>(m);
+    if (low < n) {
+      std::uint32_t threshold = (0u - n) % n;
+      while (low < threshold) {
+        m = static_cast<std::uint64_t>(next()) * n;
+        low = static_cast<std::uint32_t>(m);
+      }
+    }
+    return static_cast<std::uint32_t>(m >> 32);
+  }
+
+private:
+  // Encrypt the counter (block, stream) with ten Philox rounds.
+  void refill() {
+    std::uint32_t c0 = static_cast<std::uint32_t>(block);
+    std::uint32_t c1 = static_cast<std::uint32_t>(block >> 32);
+    std::uint32_t c2 = static_cast<std::uint32_t>(stream);
+    std::uint32_t c3 = static_cast<std::uint32_t>(stream >> 32);
+    std::uint32_t k0 = key0;
+    std::uint32_t k1 = key1;
+
+    for (int round = 0; round < 10; ++round) {
+      std::uint64_t p0 = static_cast<std::uint64_t>(0xD2511F53u) * c0;
+      std::uint64_t p1 = static_cast<std::uint64_t>(0xCD9E8D57u) * c2;
+      std::uint32_t n0 = static_cast<std::uint32_t>(p1 >> 32) ^ c1 ^ k0;
+      std::uint32_t n2 = static_cast<std::uint32_t>(p0 >> 32) ^ c3 ^ k1;
+      c1 = static_cast<std::uint32_t>(p1);
+      c3 = static_cast<std::uint32_t>(p0);
+      c0 = n0;
+      c2 = n2;
+      k0 += 0x9E3779B9u;
+      k1 += 0xBB67AE85u;
+    }
+
+    out[0] = c0;
+    out[1] = c1;
+    out[2] = c2;
+    out[3] = c3;
+    block += 1;
+    used = 0;
+  }
+
+  std::uint32_t key0;
+  std::uint32_t key1;
+  std::uint64_t stream;
+  std::uint64_t block;
+  std::uint32_t out[4];
+  int used;
+};
+
+// A reusable shoe that shuffles lazily as cards are dealt.
+//
+// Dealing card i performs step i of a forward Fisher-Yates shuffle (swap
+// position i with a random position in [i, size)), so only the prefix that
+// is actually dealt before the cut card is ever permuted. `shuffle` resets
+// the shoe to its unshuffled order and reseeds it without allocating, so
+// one Shoe can be reused for every shoe of a simulation. The deal order
+// depends only on (num_decks, seed, shoe_index).
+class Shoe {
+public:
+  Shoe(int num_decks, double penetration);
+
+  // Start shoe number `shoe_index` of the sequence for `seed`.
+  void shuffle(std::uint64_t seed, std::uint64_t shoe_index);
+
+  // Deal the next card and remove it from the remaining counts. If the
+  // shoe is empty, flags it as exhausted and returns the last card.
+  Card draw() {
+    if (pos == cards.size()) {
+      exhausted_ = true;
+      return cards.back();
+    }
+    PROFILE_COUNT(CARDS_DRAWN);
+    std::size_t j = pos + rng.bounded(static_cast<std::uint32_t>(cards.size() - pos));
+    std::swap(cards[pos], cards[j]);
+    Card card = cards[pos];
+    pos += 1;
+    card_counts[card_value(card)] -= 1;
+    return card;
+  }
+
+  // Discard `n` cards unseen; they stay in the remaining counts.
+  void burn(int n) {
+    for (int i = 0; i < n; ++i) {
+      Card card = draw();
+      if (!exhausted_) card_counts[card_value(card)] += 1;
+    }
+  }
+
+  bool past_cut() const { return pos >= cut; }
+  bool exhausted() const { return exhausted_; }
+  int position() const { return static_cast<int>(pos); }
+  int size() const { return static_cast<int>(cards.size()); }
+
+  // Remaining (unseen) card counts by value.
+  const std::array<int, 12>& counts() const { return card_counts; }
+
+  // Hi-Lo true count of the cards dealt so far (burned cards are unseen).
+  double true_count() const;
+
+private:
+  std::vector<Card> ordered;
+  std::vector<Card> cards;
+  std::array<int, 12> card_counts;
+  std::array<int, 12> full_counts;
+  PhiloxRng rng;
+  std::size_t pos;
+  std::size_t cut;
+  bool exhausted_;
+};
+
+
+// Streaming statistics of simulated rounds, in O(1) memory.
+//
+// Per-round results feed a Welford mean/variance; per-shoe totals feed a
+// bivariate Welford over (shoe net, shoe rounds) whose co-moments give
+// the shoe-clustered (cluster-robust) variance of the EV. Rounds dealt
+// from one shoe share its composition, so the clustered standard error
+// is the honest one; the independent-round one is reported alongside.
+// Two accumulators combine exactly with `merge` (Chan et al.), so each
+// thread or block of shoes can keep its own.
+struct SimStats {
+  long rounds;          // Rounds played
+  double net;           // Sum of round results
+  double mean;          // Mean round result
+  double m2;            // Sum of squared deviations from `mean`
+  long wins;            // Rounds with a positive result
+  long pushes;          // Rounds with a zero result
+  long losses;          // Rounds with a negative result
+
+  long shoes;           // Shoes played
+  double shoe_net;      // Mean net result per shoe
+  double shoe_rounds;   // Mean rounds per shoe
+  double c_net_net;     // Co-moments of (shoe net, shoe rounds)
+  double c_rounds_rounds;
+  double c_net_rounds;
+
+  SimStats();
+
+  // Record one round's net result.
+  void add_round(double result);
+  // Record the totals of one finished shoe (its rounds were added
+  // separately with add_round).
+  void add_shoe(double shoe_net_result, long shoe_round_count);
+  // Fold another accumulator into this one.
+  void merge(const SimStats& other);
+
+  // Sample variance of a round's result.
+  double variance() const;
+  // Standard error of the EV treating rounds as independent.
+  double se_independent() const;
+  // Standard error of the EV treating shoes as clusters.
+  double se_clustered() const;
+};
+
+// Streaming co-moments of per-shoe totals of two rule variants played on
+// the same shoes, in O(1) memory.
+//
+// Each shoe contributes the vector (net_a, rounds_a, net_b, rounds_b);
+// a multivariate Welford update keeps its mean and co-moment matrix. The
+// variance of the difference in EV follows from the linearized per-shoe
+// residuals of both ratio estimators, so the shoe-to-shoe variation the
+// variants share cancels out. Accumulators combine exactly with `merge`.
+struct PairedStats {
+  long shoes;
+  std::array<double, 4> mean;   // Means of (net_a, rounds_a, net_b, rounds_b)
+  std::array<double, 16> c;     // Co-moment matrix, row-major
+
+  PairedStats();
+
+  // Record one shoe's totals under both variants.
+  void add_shoe(double net_a, long rounds_a, double net_b, long rounds_b);
+  // Fold another accumulator into this one.
+  void merge(const PairedStats& other);
+
+  // EV of variant b minus EV of variant a.
+  double difference() const;
+  // Shoe-clustered standard error of `difference`.
+  double se_difference() const;
+};
+
+// Version of the hand log file format; bump on any layout change.
+const std::uint32_t HAND_LOG_VERSION = 1;
+
+// Cards and decisions kept per logged hand. Longer hands keep their first
+// ones; n_cards and n_actions still give the full counts.
+const int HAND_LOG_CARDS = 12;
+const int HAND_LOG_ACTIONS = 12;
+
+// HandRecord::flags bits.
+const std::uint8_t HAND_LOG_NATURAL = 1;          // Player was dealt a blackjack
+const std::uint8_t HAND_LOG_DEALER_BLACKJACK = 2; // Dealer had a blackjack
+const std::uint8_t HAND_LOG_SPLIT = 4;            // Hand was created by a split
+
+// One player hand of a simulated round, as stored in a hand log.
+//
+// Fields:
+//   shoe         - Index of the shoe in the run's shoe sequence.
+//   round        - Round within the shoe, from 0.
+//   seat         - Seat, from 0 (first base).
+//   hand         - Hand of the seat, from 0; split hands follow in order.
+//   n_cards      - Cards in the hand.
+//   n_actions    - Decisions taken on the hand.
+//   cards        - Card codes (see Card) in the order dealt.
+//   actions      - Action codes (see Action) in the order taken.
+//   upcard       - Card code of the dealer's upcard.
+//   dealer_total - Dealer's final total (above 21 for a bust); the dealer
+//                  only draws when some hand at the table is still live.
+//   dealer_cards - Cards in the dealer's final hand.
+//   flags        - HAND_LOG_* bits.
+//   bin          - True-count bin of the seat's strategy for the round.
+//   net          - Net result of the hand, in the same units as the
+//                  seat's bet.
+struct HandRecord {
+  std::uint64_t shoe;
+  std::uint32_t round;
+  std::uint8_t seat;
+  std::uint8_t hand;
+  std::uint8_t n_cards;
+  std::uint8_t n_actions;
+  std::uint8_t cards[HAND_LOG_CARDS];
+  std::uint8_t actions[HAND_LOG_ACTIONS];
+  std::uint8_t upcard;
+  std::uint8_t dealer_total;
+  std::uint8_t dealer_cards;
+  std::uint8_t flags;
+  std::int32_t bin;
+  double net;
+};
+static_assert(sizeof(HandRecord) == 56, "hand log records must have no padding");
+
+// Header of a hand log file.
+//
+// The file is the header followed by `count` HandRecord records, in the
+// order the writing thread played them. As for dealer tables, values are
+// in the writer's native byte order.
+struct HandLogHeader {
+  char magic[8];             // "BJHANDS1"
+  std::uint32_t version;     // HAND_LOG_VERSION
+  std::uint32_t byte_order;  // 0x01020304 as written
+  std::uint32_t record_size; // sizeof(HandRecord)
+  std::uint32_t num_decks;
+  std::uint32_t dealer_stands_soft_17;
+  std::uint32_t reserved;
+  std::uint64_t count;       // Number of records
+};
+
+// Records a HandLogWriter buffers before writing them out.
+const std::size_t HAND_LOG_BUFFER = 4096;
+
+// Writes one hand log file.
+//
+// Each simulation worker thread owns a writer, so adding a record takes
+// no lock. Records are buffered and written HAND_LOG_BUFFER at a time;
+// write errors are remembered and reported by finish(), which, like the
+// constructor, must run on the R thread.
+class HandLogWriter {
+public:
+  HandLogWriter(const std::string& path, const BlackjackRules& rules);
+  HandLogWriter(const HandLogWriter&) = delete;
+  HandLogWriter& operator=(const HandLogWriter&) = delete;
+
+  void add(const HandRecord& record) {
+    buffer.push_back(record);
+    if (buffer.size() == HAND_LOG_BUFFER) flush();
+  }
+
+  // Write the remaining records and the final count, and close the file.
+  // Stops with an R error if any write failed.
+  void finish();
+
+private:
+  void flush();
+
+  std::string path;
+  std::ofstream file;
+  HandLogHeader header;
+  std::vector<HandRecord> buffer;
+};
+
+// A hand log file, memory-mapped for the life of the object.
+class HandLog {
+public:
+  // Map the file at `path`; stops with an R error if it is not a complete
+  // hand log of the current version.
+  explicit HandLog(const std::string& path);
+
+  const HandLogHeader& header() const { return *head; }
+  std::uint64_t size() const { return head->count; }
+  const HandRecord& operator[](std::uint64_t i) const { return records[i]; }
+
+private:
+  MappedFile file;
+  const HandLogHeader* head;
+  const HandRecord* records;
+};
 
 // Function Headers
 
 bool is_blackjack_c(const std::vector<Card>& hand);
 HandVal evaluate_hand_c(const std::vector<Card>& hand);
+HandState hand_state_c(const std::vector<Card>& hand);
+bool can_double_c(const HandState& player_hand, const BlackjackRules& rules,
+                  bool split_hand);
+bool can_hit_c(const HandState& player_hand, const BlackjackRules& rules,
+               bool split_aces);
+int hand_class_c(const HandState& hand, bool use_pair);
+std::string hand_class_label(int hand_class);
 std::vector<Card> create_shoe_c(int num_decks, std::mt19937_64& rng);
-int dealer_play_c(
-    const std::vector<Card>& shoe,
-    std::vector<Card>& hand,
-    bool dealer_stands_soft_17,
-    std::array<int, 12>& card_counts,
-    int pos
-);
+std::vector<Card> create_shoe_at_c(int num_decks, std::uint64_t seed,
+                                   std::uint64_t shoe_index);
+std::array<int, 12> full_shoe_counts(int num_decks);
+std::array<int, 12> true_count_composition_c(int num_decks, double decks_left,
+                                             double tc);
+template <bool S17>
+bool dealer_play_c(Shoe& shoe, HandState& hand);
+DealerKey make_dealer_key(int total, bool soft,
+                          const std::array<int, 12>& card_counts);
+template <bool S17>
+DealerDist dealer_dist_c(int total, bool soft,
+                         std::array<int, 12>& card_counts,
+                         DealerCache& cache);
+double stand_ev_from_dist(const DealerDist& dist, int player_total);
+double dealer_natural_prob(int upcard, const std::array<int, 12>& card_counts);
+DealerDist without_natural(const DealerDist& dist, double p_natural);
+DealerDist infinite_dealer_dist_c(const HandState& dealer_hand, bool s17);
+double infinite_stand_ev_c(const HandState& dealer_hand, int player_total, bool s17);
+double infinite_hit_ev_c(const HandState& dealer_hand, const HandState& player_hand,
+                         bool s17);
+double infinite_double_ev_c(const HandState& dealer_hand, const HandState& player_hand,
+                            bool s17);
+double infinite_split_ev_c(const HandState& dealer_hand, int pair_value,
+                           const BlackjackRules& rules);
+void dealer_dist_lanes_c(const DealerLanes& lanes, double (&out)[6][DEALER_LANES]);
+void dealer_dists_by_upcard_c(const std::array<int, 12>& card_counts, bool s17,
+                              std::array<DealerDist, 10>& dists);
+const DealerTable* find_dealer_table(const BlackjackRules& rules);
+std::size_t write_dealer_table_c(const BlackjackRules& rules,
+                                 const std::string& path, int max_removed,
+                                 std::size_t cache_bytes);
+DealerKey make_ev_key(EvKind kind, int player_total, bool player_soft,
+                      int dealer_total, bool dealer_soft, bool no_natural,
+                      const std::array<int, 12>& card_counts);
+double eval_stand_c(const HandState& dealer_hand, int player_total,
+                    std::array<int, 12>& card_counts, EvContext& ctx);
+double eval_double_c(const HandState& dealer_hand, const HandState& player_hand,
+                     std::array<int, 12>& card_counts, EvContext& ctx);
+double eval_hit_c(const HandState& dealer_hand, const HandState& player_hand,
+                  std::array<int, 12>& card_counts, EvContext& ctx);
+double eval_split_c(const HandState& dealer_hand, int pair_value,
+                    std::array<int, 12>& card_counts, EvContext& ctx);
+CellEvs eval_actions_c(const HandState& dealer_hand, const HandState& player_hand,
+                       const std::array<int, 12>& card_counts,
+                       const std::vector<Action>& actions,
+                       const std::vector<EvContext*>& contexts);
+void run_tasks(const std::vector<std::function<void(int)>>& tasks, int n_threads);
+std::vector<CellEvs> strategy_table_c(const BlackjackRules& rules,
+                                      const std::array<int, 12>& card_counts,
+                                      int n_threads, std::size_t cache_bytes);
+bool same_rules(const BlackjackRules& a, const BlackjackRules& b);
+
+#ifndef BLACKJACK_STANDALONE
+void clear_ev_cache_rcpp();
 BlackjackRules parse_rules(Rcpp::List rules);
+Strategy parse_strategy(Rcpp::IntegerMatrix strategy);
 std::vector<Card> df_to_cards(Rcpp::DataFrame df);
+Rcpp::DataFrame cards_to_df(const std::vector<Card>& cards);
+std::string card_label(Card card);
+#endif
 Card create_card_helper(int v);
 
 #endif
@@ -3,47 +3,197 @@
 // Play out the dealer's hand
 //
 // The dealer draws cards from the shoe until they must stand.
-// Cards are drawn starting at index `pos` in the shoe vector.
-// The dealer's hand and card count array are updated in place.
+// The dealer's hand and the shoe's remaining card counts are updated in
+// place as cards are drawn.
+//
+// Template Parameters:
+//   S17 - If true, dealer stands on soft 17 (S17).
+//         If false, dealer hits soft 17 (H17).
 //
 // Parameters:
-//   shoe - The full shuffled shoe of cards (read-only).
-//   hand - The dealer's hand. Cards will be appended as the dealer draws.
-//   dealer_stands_soft_17 - If true, dealer stands on soft 17 (S17).
-//                           If false, dealer hits soft 17 (H17).
-//   card_counts - Array tracking remaining card counts by value.
-//                 This is decremented as cards are drawn.
-//   pos - Current position in the shoe (index of next card to draw).
+//   shoe - The shoe to draw from.
+//   hand - The dealer's hand. Cards are added as the dealer draws.
 //
 // Returns:
-//   The updated shoe position after the dealer finishes drawing.
-//
-int dealer_play_c(
-    const std::vector<Card>& shoe,
-    std::vector<Card>& hand,
-    bool dealer_stands_soft_17,
-    std::array<int, 12>& card_counts,
-    int pos
-) {
-  // Evaluate the dealer's current hand
-  HandVal result = evaluate_hand_c(hand);
-
+//   true if the dealer finished drawing, false if the shoe ran out first.
+//
+template <bool S17>
+bool dealer_play_c(Shoe& shoe, HandState& hand) {
   // Dealer draws while total is less than 17,
   // or while on soft 17 if the table rule requires hitting
-  while (result.total < 17 ||
-         (result.code == "S17" && !dealer_stands_soft_17)) {
-
-    // Draw the next card from the shoe
-    const Card& card = shoe[pos];
-    pos += 1;
-    // Update remaining card counts
-    card_counts[card.value] -= 1;
-    // Add card to dealer's hand
-    hand.push_back(card);
-    // Re-evaluate hand after drawing
-    result = evaluate_hand_c(hand);
+  while (!dealer_stands<S17>(hand.total(), hand.soft())) {
+
+    // Draw the next card from the shoe and add it to the dealer's hand
+    Card card = shoe.draw();
+    if (shoe.exhausted()) return false;
+    hand.add(card_value(card));
+  }
+
+  return true;
+}
+
+template bool dealer_play_c<true>(Shoe& shoe, HandState& hand);
+template bool dealer_play_c<false>(Shoe& shoe, HandState& hand);
+
+// Build the cache key for a dealer hand state and remaining shoe.
+//
+// Parameters:
+//   total       - The dealer's current best total.
+//   soft        - True if an Ace in the dealer's hand counts as 11.
+//   card_counts - Remaining card counts in the shoe (indices 2-11).
+//
+// Returns:
+//   A DealerKey that is equal for any two identical (state, shoe) pairs.
+//
+DealerKey make_dealer_key(int total, bool soft,
+                          const std::array<int, 12>& card_counts) {
+  DealerKey key;
+  key.lo = 0;
+  for (int v = 2; v <= 9; ++v) {
+    key.lo |= static_cast<std::uint64_t>(card_counts[v] & 0xFF) << (8 * (v - 2));
+  }
+  key.hi = static_cast<std::uint64_t>(card_counts[10] & 0xFFFF) |
+    (static_cast<std::uint64_t>(card_counts[11] & 0xFF) << 16) |
+    (static_cast<std::uint64_t>(total & 0xFF) << 24) |
+    (static_cast<std::uint64_t>(soft ? 1 : 0) << 32);
+  return key;
+}
+
+// Compute the probability distribution of the dealer's final outcome.
+//
+// The dealer draws from `card_counts` until reaching a standing total,
+// honoring the soft 17 rule. Distributions for non-terminal states are
+// memoized in `cache`, so each (dealer state, remaining shoe) is expanded
+// at most once per query regardless of how often the player's search
+// reaches it.
+//
+// Template Parameters:
+//   S17 - If true, dealer stands on soft 17; if false, dealer hits it.
+//
+// Parameters:
+//   total       - The dealer's current best total.
+//   soft        - True if an Ace in the dealer's hand counts as 11.
+//   card_counts - Remaining card counts in the shoe. Temporarily modified
+//                 during recursion and restored before returning.
+//   cache       - Memo table shared across the query (or across queries
+//                 when the caller keeps it). Fixed size, so the recursion
+//                 never allocates.
+//
+// Returns:
+//   A DealerDist over final totals 17-21 and bust.
+//
+template <bool S17>
+DealerDist dealer_dist_c(int total, bool soft,
+                         std::array<int, 12>& card_counts,
+                         DealerCache& cache) {
+  DealerDist dist;
+  dist.p.fill(0.0);
+
+  // Base Case: Dealer busts
+  if (total > 21) {
+    dist.p[5] = 1.0;
+    return dist;
+  }
+
+  // Dealer must hit if below 17, or on soft 17 when H17 rules apply
+  if (dealer_stands<S17>(total, soft)) {
+    dist.p[total - 17] = 1.0;
+    return dist;
   }
 
-  // Return the updated shoe position
-  return pos;
+  DealerKey key = make_dealer_key(total, soft, card_counts);
+  if (cache.probe(key, dist)) {
+    PROFILE_COUNT(DEALER_CACHE_HITS);
+    return dist;
+  }
+  PROFILE_COUNT(DEALER_NODES);
+
+  double num_cards = 0.0;
+  for (int i = 2; i <= 11; ++i) num_cards += card_counts[i];
+
+  // Recursive Step: Dealer must hit
+  for (int v = 2; v <= 11; ++v) {
+    if (card_counts[v] > 0) {
+      double p_card = static_cast<double>(card_counts[v]) / num_cards;
+
+      // Add the card, counting an Ace as 1 if 11 would bust
+      int next_total = total + v;
+      int aces = (soft ? 1 : 0) + (v == 11 ? 1 : 0);
+      while (next_total > 21 && aces > 0) {
+        next_total -= 10;
+        aces -= 1;
+      }
+
+      card_counts[v]--;
+      DealerDist sub = dealer_dist_c<S17>(next_total, aces > 0, card_counts,
+                                          cache);
+      card_counts[v]++;
+
+      for (int k = 0; k < 6; ++k) dist.p[k] += p_card * sub.p[k];
+    }
+  }
+
+  cache.store(key, dist);
+  return dist;
+}
+
+template DealerDist dealer_dist_c<true>(int total, bool soft,
+                                        std::array<int, 12>& card_counts,
+                                        DealerCache& cache);
+template DealerDist dealer_dist_c<false>(int total, bool soft,
+                                         std::array<int, 12>& card_counts,
+                                         DealerCache& cache);
+
+// Convert a dealer outcome distribution into the EV of standing.
+//
+// Parameters:
+//   dist         - Distribution of the dealer's final outcome.
+//   player_total - Player's final hand total (21 or less).
+//
+// Returns:
+//   The expected value of standing, in units of the original bet.
+//
+double stand_ev_from_dist(const DealerDist& dist, int player_total) {
+  // Dealer busts: player wins
+  double ev = dist.p[5];
+
+  for (int k = 0; k < 5; ++k) {
+    int dealer_total = 17 + k;
+    if (dealer_total < player_total) ev += dist.p[k];      // Player wins
+    else if (dealer_total > player_total) ev -= dist.p[k]; // Player loses
+  }
+
+  return ev;
+}
+
+// Probability that a dealer showing only `upcard` holds a natural: that
+// the hole card drawn from `card_counts` is a ten under an Ace or an Ace
+// under a ten. 0 for any other upcard.
+double dealer_natural_prob(int upcard, const std::array<int, 12>& card_counts) {
+  if (upcard != 10 && upcard != 11) return 0.0;
+  int total = 0;
+  for (int v = 2; v <= 11; ++v) total += card_counts[v];
+  if (total == 0) return 0.0;
+  return static_cast<double>(card_counts[upcard == 11 ? 10 : 11]) / total;
+}
+
+// Condition the outcome distribution of a dealer showing only an upcard on
+// the dealer not holding a natural.
+//
+// A natural always ends on 21, so its probability is taken out of the 21
+// outcome and the rest renormalized. Only the dealer's outcome is
+// conditioned: the shoe the player drew from beforehand still holds the
+// natural's hole card. If nothing but a natural can be dealt
+// there is no such hand and the distribution is returned unchanged.
+//
+// Parameters:
+//   dist      - Unconditioned distribution of the dealer's final outcome.
+//   p_natural - Probability of a natural (see dealer_natural_prob).
+//
+DealerDist without_natural(const DealerDist& dist, double p_natural) {
+  if (p_natural <= 0.0 || p_natural >= 1.0) return dist;
+  DealerDist out = dist;
+  out.p[4] -= p_natural;
+  for (double& p : out.p) p /= 1.0 - p_natural;
+  return out;
 }
@@ -0,0 +1,210 @@
+#include "blackjack.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define BLACKJACK_AVX2_DISPATCH 1
+#include <immintrin.h>
+#endif
+
+// Dealer states of the dynamic program: (hard total 0-21, holds an Ace),
+// where the hard total counts every Ace as 1. Each draw strictly increases
+// the hard total, so processing states in increasing hard total visits
+// every state after all of its predecessors.
+const int DP_STATES = 22 * 2;
+
+// Per-lane probability mass of each dealer state.
+struct DealerMass {
+  alignas(32) double m[DP_STATES][DEALER_LANES];
+};
+
+// Whether the dealer stands in a DP state, and on which total.
+static bool state_stands(int hard, bool ace, bool s17, int& total) {
+  bool soft = ace && hard + 10 <= 21;
+  total = soft ? hard + 10 : hard;
+  return s17 ? dealer_stands<true>(total, soft) : dealer_stands<false>(total, soft);
+}
+
+// Portable kernel: one lane at a time inside each state.
+static void propagate_scalar(const DealerLanes& lanes, DealerMass& mass,
+                             double (&out)[6][DEALER_LANES]) {
+  for (int hard = 1; hard <= 21; ++hard) {
+    for (int ace = 0; ace <= 1; ++ace) {
+      const double* m = mass.m[hard * 2 + ace];
+      int total;
+      if (state_stands(hard, ace != 0, lanes.s17, total)) {
+        for (int l = 0; l < DEALER_LANES; ++l) out[total - 17][l] += m[l];
+        continue;
+      }
+      for (int v = 2; v <= 11; ++v) {
+        int next = hard + (v == 11 ? 1 : v);
+        double* target = next > 21 ? out[5] : mass.m[next * 2 + (ace | (v == 11))];
+        const double* p = lanes.p[v - 2];
+        for (int l = 0; l < DEALER_LANES; ++l) target[l] += m[l] * p[l];
+      }
+    }
+  }
+}
+
+#ifdef BLACKJACK_AVX2_DISPATCH
+// AVX2 kernel: four lanes per instruction. Multiplies and adds are kept
+// separate (no FMA) so results are bit-identical to the scalar kernel.
+// `lanes` and `mass` are 32-byte aligned; `out` is the caller's array and
+// may not be, so it is only accessed with unaligned loads and stores.
+__attribute__((target("avx2")))
+static void propagate_avx2(const DealerLanes& lanes, DealerMass& mass,
+                           double (&out)[6][DEALER_LANES]) {
+  for (int hard = 1; hard <= 21; ++hard) {
+    for (int ace = 0; ace <= 1; ++ace) {
+      const double* m = mass.m[hard * 2 + ace];
+      int total;
+      if (state_stands(hard, ace != 0, lanes.s17, total)) {
+        for (int l = 0; l < DEALER_LANES; l += 4) {
+          __m256d sum = _mm256_add_pd(_mm256_loadu_pd(out[total - 17] + l),
+                                      _mm256_load_pd(m + l));
+          _mm256_storeu_pd(out[total - 17] + l, sum);
+        }
+        continue;
+      }
+      for (int v = 2; v <= 11; ++v) {
+        int next = hard + (v == 11 ? 1 : v);
+        double* target = next > 21 ? out[5] : mass.m[next * 2 + (ace | (v == 11))];
+        const double* p = lanes.p[v - 2];
+        for (int l = 0; l < DEALER_LANES; l += 4) {
+          __m256d add = _mm256_mul_pd(_mm256_load_pd(m + l), _mm256_load_pd(p + l));
+          _mm256_storeu_pd(target + l, _mm256_add_pd(_mm256_loadu_pd(target + l), add));
+        }
+      }
+    }
+  }
+}
+#endif
+
+// Compute dealer outcome distributions for every lane at once.
+//
+// Each lane is one dealer hand that draws with replacement from its own
+// fixed card probabilities, so lanes can hold the ten upcards against one
+// shoe, one upcard against many compositions, or any mix. Drawing with
+// replacement makes this exact for an infinite deck and an approximation
+// (ignoring depletion during the dealer's draw) for a finite shoe;
+// dealer_dist_c remains the exact composition-dependent computation.
+//
+// The strategy-table builders (strategy_table_c, count_strategy_rcpp)
+// therefore do not use this kernel: their cells compare EVs that often
+// differ by less than the approximation error (up to 0.003 for one deck),
+// and the infinite-deck path already reads precomputed tables.
+//
+// The AVX2 kernel is used when the CPU supports it, otherwise the
+// portable one; both give identical results.
+//
+// Parameters:
+//   lanes - Card probabilities and starting upcard of every lane, and the
+//           soft 17 rule.
+//   out   - Set to the distribution of each lane: out[k][lane] for final
+//           totals 17-21 (k = 0-4) and bust (k = 5). Unused lanes are 0.
+//
+void dealer_dist_lanes_c(const DealerLanes& lanes, double (&out)[6][DEALER_LANES]) {
+  DealerMass mass;
+  std::fill(&mass.m[0][0], &mass.m[0][0] + DP_STATES * DEALER_LANES, 0.0);
+  std::fill(&out[0][0], &out[0][0] + 6 * DEALER_LANES, 0.0);
+
+  for (int l = 0; l < DEALER_LANES; ++l) {
+    int up = lanes.upcard[l];
+    if (up < 2 || up > 11) continue;
+    mass.m[(up == 11 ? 1 : up) * 2 + (up == 11)][l] = 1.0;
+  }
+
+#ifdef BLACKJACK_AVX2_DISPATCH
+  static const bool has_avx2 = __builtin_cpu_supports("avx2");
+  if (has_avx2) {
+    propagate_avx2(lanes, mass, out);
+    return;
+  }
+#endif
+  propagate_scalar(lanes, mass, out);
+}
+
+// Dealer outcome distributions for all ten upcards against one shoe.
+//
+// Lane u - 2 holds upcard u, drawing from `card_counts` with that upcard
+// removed.
+//
+// Parameters:
+//   card_counts - Remaining card counts including the upcard (indices 2-11).
+//   s17         - True if the dealer stands on soft 17.
+//   dists       - Set to the distribution for upcards 2 through Ace.
+//
+void dealer_dists_by_upcard_c(const std::array<int, 12>& card_counts, bool s17,
+                              std::array<DealerDist, 10>& dists) {
+  DealerLanes lanes;
+  lanes.s17 = s17;
+  double total = 0.0;
+  for (int v = 2; v <= 11; ++v) total += card_counts[v];
+
+  for (int l = 0; l < DEALER_LANES; ++l) {
+    int up = l + 2;
+    lanes.upcard[l] = (up <= 11 && card_counts[up] > 0) ? up : 0;
+    for (int v = 2; v <= 11; ++v) {
+      double count = card_counts[v] - (v == up ? 1 : 0);
+      lanes.p[v - 2][l] = (up <= 11 && total > 1) ? count / (total - 1.0) : 0.0;
+    }
+  }
+
+  double out[6][DEALER_LANES];
+  dealer_dist_lanes_c(lanes, out);
+  for (int u = 0; u < 10; ++u) {
+    for (int k = 0; k < 6; ++k) dists[u].p[k] = out[k][u];
+  }
+}
+
+#ifndef BLACKJACK_STANDALONE
+// Dealer outcome probabilities for every upcard.
+//
+// Parameters:
+//   rules_obj     - R list representing a blackjack_rules object.
+//   card_counts_r - Integer vector of remaining card counts by value
+//                   (length 12, indices 2-11 used), including the upcard.
+//   exact         - If true (default), use the exact composition-dependent
+//                   dealer recursion; if false, the vectorized
+//                   fixed-probability kernel, which is much faster but
+//                   exact only for an infinite deck (biased by up to about
+//                   0.003 for one deck).
+//
+// Returns:
+//   A 10 x 6 matrix with rows for upcards 2 through Ace and columns for
+//   final totals 17-21 and bust.
+//
+// [[Rcpp::export]]
+Rcpp::NumericMatrix dealer_probs_rcpp(Rcpp::List rules_obj,
+                                      Rcpp::IntegerVector card_counts_r,
+                                      bool exact = true) {
+  BlackjackRules rules = parse_rules(rules_obj);
+  std::array<int, 12> card_counts;
+  for (int i = 0; i < 12; ++i) card_counts[i] = card_counts_r[i];
+
+  std::array<DealerDist, 10> dists;
+  if (exact) {
+    DealerCache cache(static_cast<std::size_t>(64) * 1024 * 1024);
+    for (int up = 2; up <= 11; ++up) {
+      DealerDist& dist = dists[up - 2];
+      dist.p.fill(0.0);
+      if (card_counts[up] == 0) continue;
+      card_counts[up]--;
+      dist = rules.dealer_stands_soft_17
+        ? dealer_dist_c<true>(up, up == 11, card_counts, cache)
+        : dealer_dist_c<false>(up, up == 11, card_counts, cache);
+      card_counts[up]++;
+    }
+  } else {
+    dealer_dists_by_upcard_c(card_counts, rules.dealer_stands_soft_17, dists);
+  }
+
+  Rcpp::NumericMatrix out(10, 6);
+  for (int u = 0; u < 10; ++u) {
+    for (int k = 0; k < 6; ++k) out(u, k) = dists[u].p[k];
+  }
+  Rcpp::rownames(out) = Rcpp::CharacterVector::create("2", "3", "4", "5", "6",
+                                                      "7", "8", "9", "10", "A");
+  Rcpp::colnames(out) = Rcpp::CharacterVector::create("17", "18", "19", "20",
+                                                      "21", "bust");
+  return out;
+}
+#endif
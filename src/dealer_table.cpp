@@ -0,0 +1,202 @@
+#include "blackjack.h"
+#include <cstring>
+#include <fstream>
+#include <memory>
+
+static const char DEALER_TABLE_MAGIC[8] = {'B', 'J', 'D', 'E', 'A', 'L', 'E', 'R'};
+static const std::uint32_t DEALER_TABLE_BYTE_ORDER = 0x01020304;
+
+// Order of entries in a dealer table file.
+static bool key_less(const DealerKey& a, const DealerKey& b) {
+  return a.hi != b.hi ? a.hi < b.hi : a.lo < b.lo;
+}
+
+// Map a dealer table file and check its header.
+DealerTable::DealerTable(const std::string& path)
+  : file(path, "dealer table"), head(nullptr), entries(nullptr) {
+  const unsigned char* data = file.data();
+  std::size_t bytes = file.size();
+
+  head = reinterpret_cast<const DealerTableHeader*>(data);
+  std::string problem;
+  if (bytes < sizeof(DealerTableHeader) ||
+      std::memcmp(head->magic, DEALER_TABLE_MAGIC, sizeof(DEALER_TABLE_MAGIC)) != 0) {
+    problem = "is not a dealer table";
+  } else if (head->byte_order != DEALER_TABLE_BYTE_ORDER) {
+    problem = "was written on a platform with a different byte order";
+  } else if (head->version != DEALER_TABLE_VERSION) {
+    problem = "has format version " + std::to_string(head->version) +
+      ", expected " + std::to_string(DEALER_TABLE_VERSION);
+  } else if (bytes != sizeof(DealerTableHeader) + head->count * sizeof(DealerTableEntry)) {
+    problem = "is truncated";
+  }
+  if (!problem.empty()) Rcpp::stop(path + " " + problem);
+
+  entries = reinterpret_cast<const DealerTableEntry*>(data + sizeof(DealerTableHeader));
+}
+
+// Binary search over the sorted entries.
+bool DealerTable::find(const DealerKey& key, DealerDist& dist) const {
+  const DealerTableEntry* end = entries + head->count;
+  const DealerTableEntry* it = std::lower_bound(
+    entries, end, key,
+    [](const DealerTableEntry& e, const DealerKey& k) { return key_less(e.key, k); });
+  if (it == end || !(it->key == key)) return false;
+  dist = it->dist;
+  return true;
+}
+
+// Dealer tables loaded in this session.
+//
+// Only changed from the R thread by load_dealer_table_rcpp and
+// unload_dealer_tables_rcpp, never while a computation is running, so
+// worker threads may read it without locking.
+static std::vector<std::unique_ptr<DealerTable>> loaded_tables;
+
+// Find a loaded table computed for the deck count and soft 17 rule of
+// `rules`, or null if there is none.
+const DealerTable* find_dealer_table(const BlackjackRules& rules) {
+  for (const std::unique_ptr<DealerTable>& table : loaded_tables) {
+    const DealerTableHeader& h = table->header();
+    if ((h.dealer_stands_soft_17 != 0) == rules.dealer_stands_soft_17 &&
+        static_cast<int>(h.num_decks) == rules.num_decks) {
+      return table.get();
+    }
+  }
+  return nullptr;
+}
+
+// Add every removal set of up to `left` more cards, from value `from`
+// upwards, to the table being built.
+static void enumerate_removals(int upcard, int from, int left,
+                               std::array<int, 12>& card_counts,
+                               const BlackjackRules& rules, DealerCache& cache,
+                               std::vector<DealerTableEntry>& out) {
+  bool soft = (upcard == 11);
+  DealerTableEntry entry;
+  entry.key = make_dealer_key(upcard, soft, card_counts);
+  entry.dist = rules.dealer_stands_soft_17
+    ? dealer_dist_c<true>(upcard, soft, card_counts, cache)
+    : dealer_dist_c<false>(upcard, soft, card_counts, cache);
+  out.push_back(entry);
+
+  if (left == 0) return;
+  for (int v = from; v <= 11; ++v) {
+    if (card_counts[v] == 0) continue;
+    card_counts[v]--;
+    enumerate_removals(upcard, v, left - 1, card_counts, rules, cache, out);
+    card_counts[v]++;
+  }
+}
+
+// Precompute dealer distributions and write them as a dealer table file.
+//
+// For every upcard, the table holds the distribution of the dealer's
+// final outcome from a full shoe with the upcard removed, and with every
+// further set of up to `max_removed` cards removed (the player's cards,
+// other seats' cards, ...). Entries are independent of everything but
+// the composition and the soft 17 rule, so one file serves every query
+// under those rules.
+//
+// Parameters:
+//   rules       - Table rules; only num_decks and dealer_stands_soft_17
+//                 matter.
+//   path        - File to write.
+//   max_removed - Largest number of extra cards removed.
+//   cache_bytes - Memory budget of the dealer cache used while building.
+//
+// Returns:
+//   The number of entries written.
+//
+std::size_t write_dealer_table_c(const BlackjackRules& rules,
+                                 const std::string& path, int max_removed,
+                                 std::size_t cache_bytes) {
+  DealerCache cache(cache_bytes);
+  std::vector<DealerTableEntry> out;
+  for (int upcard = 2; upcard <= 11; ++upcard) {
+    std::array<int, 12> counts = full_shoe_counts(rules.num_decks);
+    counts[upcard]--;
+    enumerate_removals(upcard, 2, max_removed, counts, rules, cache, out);
+    Rcpp::checkUserInterrupt();
+  }
+  std::sort(out.begin(), out.end(), [](const DealerTableEntry& a, const DealerTableEntry& b) {
+    return key_less(a.key, b.key);
+  });
+
+  DealerTableHeader header;
+  std::memset(&header, 0, sizeof(header));
+  std::memcpy(header.magic, DEALER_TABLE_MAGIC, sizeof(DEALER_TABLE_MAGIC));
+  header.version = DEALER_TABLE_VERSION;
+  header.byte_order = DEALER_TABLE_BYTE_ORDER;
+  header.dealer_stands_soft_17 = rules.dealer_stands_soft_17 ? 1 : 0;
+  header.num_decks = static_cast<std::uint32_t>(rules.num_decks);
+  header.max_removed = static_cast<std::uint32_t>(max_removed);
+  header.count = out.size();
+
+  std::ofstream file(path.c_str(), std::ios::binary | std::ios::trunc);
+  if (!file) Rcpp::stop("cannot write dealer table " + path);
+  file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+  file.write(reinterpret_cast<const char*>(out.data()),
+             static_cast<std::streamsize>(out.size() * sizeof(DealerTableEntry)));
+  if (!file) Rcpp::stop("error writing dealer table " + path);
+
+  return out.size();
+}
+
+#ifndef BLACKJACK_STANDALONE
+// Write a dealer table file for a rule set (see write_dealer_table_c).
+//
+// Parameters:
+//   rules_obj   - R list representing a blackjack_rules object.
+//   path        - File to write.
+//   max_removed - Largest number of extra cards removed (0-6).
+//   cache_mb    - Memory budget in megabytes for the dealer cache used
+//                 while building.
+//
+// Returns:
+//   The number of entries written.
+//
+// [[Rcpp::export]]
+double write_dealer_table_rcpp(Rcpp::List rules_obj, std::string path,
+                               int max_removed = 4, double cache_mb = 256) {
+  BlackjackRules rules = parse_rules(rules_obj);
+  if (max_removed < 0 || max_removed > 6) Rcpp::stop("max_removed must be between 0 and 6");
+
+  std::size_t cache_bytes = static_cast<std::size_t>(cache_mb * 1024 * 1024);
+  return static_cast<double>(write_dealer_table_c(rules, path, max_removed, cache_bytes));
+}
+
+// Memory-map a dealer table for use by every later EV query whose rules
+// match its deck count and soft 17 rule.
+//
+// Parameters:
+//   path - File written by write_dealer_table_rcpp.
+//
+// Returns:
+//   A list describing the table: num_decks, dealer_stands_soft_17,
+//   max_removed and entries.
+//
+// [[Rcpp::export]]
+Rcpp::List load_dealer_table_rcpp(std::string path) {
+  std::unique_ptr<DealerTable> table(new DealerTable(path));
+  const DealerTableHeader h = table->header();
+
+  // A kept EV context would not see the new table
+  clear_ev_cache_rcpp();
+  loaded_tables.push_back(std::move(table));
+
+  return Rcpp::List::create(
+    Rcpp::Named("num_decks")             = static_cast<int>(h.num_decks),
+    Rcpp::Named("dealer_stands_soft_17") = h.dealer_stands_soft_17 != 0,
+    Rcpp::Named("max_removed")           = static_cast<int>(h.max_removed),
+    Rcpp::Named("entries")               = static_cast<double>(h.count)
+  );
+}
+
+// Unmap every loaded dealer table.
+// [[Rcpp::export]]
+void unload_dealer_tables_rcpp() {
+  clear_ev_cache_rcpp();
+  loaded_tables.clear();
+}
+#endif
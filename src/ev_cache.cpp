@@ -0,0 +1,42 @@
+#include "blackjack.h"
+
+// Build the transposition-table key for a player EV.
+//
+// The composition, dealer total and dealer soft flag occupy the same bits
+// as in a DealerKey; the player's state, the peek conditioning and the
+// kind of EV are packed into the unused upper bits of `hi`.
+//
+// Parameters:
+//   kind         - Which EV is stored (stand, hit or double).
+//   player_total - Player's current best total.
+//   player_soft  - True if the player's hand is soft.
+//   dealer_total - Dealer's current best total.
+//   dealer_soft  - True if the dealer's hand is soft.
+//   no_natural   - True if the dealer is a lone upcard known not to hold a
+//                  natural (see EvContext::dealer_peeked); such a ten
+//                  must not share a key with a two-card hard 10.
+//   card_counts  - Remaining card counts in the shoe.
+//
+// Returns:
+//   A key that is equal for identical (kind, player, dealer, shoe) states.
+//
+DealerKey make_ev_key(EvKind kind, int player_total, bool player_soft,
+                      int dealer_total, bool dealer_soft, bool no_natural,
+                      const std::array<int, 12>& card_counts) {
+  DealerKey key = make_dealer_key(dealer_total, dealer_soft, card_counts);
+  key.hi |= (static_cast<std::uint64_t>(player_total & 0xFF) << 40) |
+    (static_cast<std::uint64_t>(player_soft ? 1 : 0) << 48) |
+    (static_cast<std::uint64_t>(no_natural ? 1 : 0) << 49) |
+    (static_cast<std::uint64_t>(static_cast<int>(kind)) << 56);
+  return key;
+}
+
+// Split a memory budget evenly between the dealer distribution cache and
+// the transposition table. Dealer subtrees are far more expensive to
+// recompute than player EVs, so the dealer cache gets a full half even
+// though each of its entries is almost three times larger. Both tables
+// are allocated here, once, so the recursive search never allocates.
+// A loaded dealer table for the same rules is picked up here as well.
+EvContext::EvContext(const BlackjackRules& rules, std::size_t max_bytes)
+  : rules(rules), dealer(max_bytes / 2), table(max_bytes / 2),
+    dealer_table(find_dealer_table(rules)), dealer_peeked(false) {}
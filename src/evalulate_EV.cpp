@@ -1,6 +1,10 @@
 #include "blackjack.h"
 #include <algorithm>
+#include <cmath>
+#include <memory>
+#include <thread>
 
+#ifndef BLACKJACK_STANDALONE
 // Evaluates the Expected Value (EV) of the Surrender action.
 // [[Rcpp::export]]
 double eval_surrender_c() {
@@ -27,74 +31,114 @@ double eval_insurance_c(Rcpp::IntegerVector card_counts) {
   // EV calculation
   return (p_ten * 2.0) - (p_not_ten * 1.0);
 }
+#endif
 
 
-// Recursively compute the EV if player stands.
+// Whether `dealer_hand` is a lone upcard the dealer has already checked for
+// a natural, so EVs against it are conditioned on there being none.
+static bool known_no_natural(const HandState& dealer_hand, const EvContext& ctx) {
+  return ctx.dealer_peeked && dealer_hand.num_cards == 1;
+}
+
+// Compute the EV if player stands.
+//
+// The dealer's draw tree does not depend on the player's total, so the
+// dealer's final-outcome distribution is computed once per (dealer state,
+// remaining shoe) and memoized in the context, or read from a loaded
+// dealer table; the stand EV is then a dot product of that distribution
+// with the win/push/loss payoffs. If the context says the dealer has
+// peeked, the outcome of a lone Ace or ten upcard is conditioned on having
+// no natural. The player's earlier draws are not, so EVs above this leaf
+// only approximate the fully conditioned ones.
+//
 // Parameters:
 //   dealer_hand  - Dealer's current hand.
 //   player_total - Player's final hand total.
-//   card_counts  - Remaining card counts in the shoe.
-//   rules        - Table rules.
-double eval_stand_c(std::vector<Card> dealer_hand, int player_total,
-                    std::array<int, 12> card_counts, const BlackjackRules& rules) {
-
-  HandVal hv = evaluate_hand_c(dealer_hand);
-
-  // Base Case: Dealer busts
-  if (hv.total > 21) {
-    return 1.0; // Player wins (EV = 1.0)
+//   card_counts  - Remaining card counts in the shoe (restored before
+//                  returning).
+//   ctx          - Table rules and caches for this query.
+template <class R>
+static double stand_ev(const HandState& dealer_hand, int player_total,
+                       std::array<int, 12>& card_counts, EvContext& ctx) {
+
+  int dealer_total = dealer_hand.total();
+  bool dealer_soft = dealer_hand.soft();
+
+  bool no_natural = known_no_natural(dealer_hand, ctx);
+  DealerKey key = make_ev_key(EvKind::STAND, player_total, false,
+                              dealer_total, dealer_soft, no_natural, card_counts);
+  double cached;
+  if (ctx.table.probe(key, cached)) {
+    PROFILE_COUNT(EV_CACHE_HITS);
+    return cached;
   }
-
-  // Calculate number of cards remaining in the deck
-  double num_cards = 0.0;
-  for (int i = 2; i <= 11; ++i) num_cards += card_counts[i];
-
-  // Dealer must hit if below 17, or on soft 17 when H17 rules apply
-  bool dealer_stands = (hv.total > 17) ||
-    (hv.total == 17 && (rules.dealer_stands_soft_17 || !hv.soft));
-
-  if (dealer_stands) {
-    if (hv.total < player_total) return 1.0;  // Player wins
-    if (hv.total > player_total) return -1.0; // Player loses
-    return 0.0; // Push
+  PROFILE_COUNT(EV_NODES);
+
+  // A precomputed table answers common states without any recursion
+  DealerDist dist;
+  if (ctx.dealer_table != nullptr &&
+      ctx.dealer_table->find(make_dealer_key(dealer_total, dealer_soft, card_counts),
+                             dist)) {
+    PROFILE_COUNT(DEALER_TABLE_HITS);
+  } else {
+    dist = dealer_dist_c<R::dealer_stands_soft_17>(dealer_total, dealer_soft,
+                                                   card_counts, ctx.dealer);
   }
-
-  // Recursive Step: Dealer must hit
-  double expected_value = 0.0;
-
-  for (int v = 2; v <= 11; ++v) {
-    if (card_counts[v] > 0) {
-      // Probability of drawing this specific card value
-      double p_card = static_cast<double>(card_counts[v]) / num_cards;
-
-      // Simulate drawing the card
-      std::array<int, 12> next_card_counts = card_counts;
-      next_card_counts[v]--;
-
-
-      Card card;
-      card = create_card_helper(v);
-
-      // Add card to dealer's hand
-      dealer_hand.push_back(card);
-      // Recursively compute EV for this draw and weight it by its probability.
-      expected_value += p_card * eval_stand_c(dealer_hand, player_total,
-                                            next_card_counts, rules);
-      dealer_hand.pop_back();
-    }
+  if (no_natural) {
+    dist = without_natural(dist, dealer_natural_prob(dealer_total, card_counts));
   }
+  double expected_value = stand_ev_from_dist(dist, player_total);
 
+  ctx.table.store(key, expected_value);
   return expected_value;
 }
+
+// EV of doubling given that the card drawn is a `v` (which must be in the
+// shoe), in units of the original bet.
+template <class R>
+static double double_branch_ev(const HandState& dealer_hand, const HandState& player_hand,
+                               int v, std::array<int, 12>& card_counts, EvContext& ctx) {
+  // Add the drawn card to a copy of the player's hand and take it out of
+  // the shoe for the subtree
+  HandState hv = player_hand;
+  hv.add(v);
+  card_counts[v]--;
+
+  double ev;
+  if (hv.total() > 21) {
+    // Player busts: loses 2 units because the bet was doubled
+    ev = -2.0;
+  }
+  else {
+    // Player stands: dealer plays out; outcome is worth 2 units
+    ev = 2.0 * stand_ev<R>(dealer_hand, hv.total(), card_counts, ctx);
+  }
+  card_counts[v]++;
+  return ev;
+}
+
 // Recursively compute the Expected Value (EV) of the Double Down action.
 // Parameters:
 //   dealer_hand  - Dealer's current hand.
 //   player_hand  - Player's current hand before doubling.
-//   card_counts  - Remaining card counts in the shoe.
-//   rules        - Blackjack table rules.
+//   card_counts  - Remaining card counts in the shoe. Temporarily modified
+//                  during recursion and restored before returning.
+//   ctx          - Table rules and caches for this query.
 //
-double eval_double_c(std::vector<Card> dealer_hand, std::vector<Card> player_hand,
-                     std::array<int, 12> card_counts, const BlackjackRules& rules) {
+template <class R>
+static double double_ev(const HandState& dealer_hand, const HandState& player_hand,
+                        std::array<int, 12>& card_counts, EvContext& ctx) {
+
+  // Reuse the result if this state was already reached
+  DealerKey key = make_ev_key(EvKind::DOUBLE, player_hand.total(), player_hand.soft(),
+                              dealer_hand.total(), dealer_hand.soft(),
+                              known_no_natural(dealer_hand, ctx), card_counts);
+  double cached;
+  if (ctx.table.probe(key, cached)) {
+    PROFILE_COUNT(EV_CACHE_HITS);
+    return cached;
+  }
+  PROFILE_COUNT(EV_NODES);
 
   double expected_value = 0.0;
   // Total number of cards remaining (used for draw probabilities)
@@ -106,49 +150,80 @@ double eval_double_c(std::vector<Card> dealer_hand, std::vector<Card> player_han
     if (card_counts[v] > 0) {
       // Calculate the probability of drawing a card
       double p_card = static_cast<double>(card_counts[v]) / total_cards;
-
-      Card card;
-      card = create_card_helper(v);
-
-      // Add the drawn card to the player's hand
-      player_hand.push_back(card);
-
-      // Evaluate player's final total after the one-card draw
-      HandVal hv = evaluate_hand_c(player_hand);
-      auto next_counts = card_counts;
-      next_counts[v]--;
-
-      if (hv.total > 21) {
-        // Player busts: loses 2 units because the bet was doubled
-        expected_value += p_card * -2.0;
-      }
-      else {
-        // Player stands: dealer plays out; outcome is worth 2 units
-        double stand_ev = eval_stand_c(dealer_hand, hv.total,
-                                        next_counts, rules);
-        expected_value += p_card * (2.0 * stand_ev);
-      }
-      // Undo mutation for the next branch
-      player_hand.pop_back();
+      expected_value += p_card * double_branch_ev<R>(dealer_hand, player_hand, v,
+                                                     card_counts, ctx);
     }
   }
 
+  ctx.table.store(key, expected_value);
   return expected_value;
 }
 
+template <class R>
+static double hit_ev(const HandState& dealer_hand, const HandState& player_hand,
+                     std::array<int, 12>& card_counts, EvContext& ctx);
+
+// EV of hitting given that the card drawn is a `v` (which must be in the
+// shoe), with the player continuing optimally afterwards.
+template <class R>
+static double hit_branch_ev(const HandState& dealer_hand, const HandState& player_hand,
+                            int v, std::array<int, 12>& card_counts, EvContext& ctx) {
+  // Add the drawn card to a copy of the player's hand and take it out of
+  // the shoe for the subtree
+  HandState hv = player_hand;
+  hv.add(v);
+  card_counts[v]--;
+
+  double ev;
+  if (hv.total() > 21) {
+    // Player busts: loses 1 unit
+    ev = -1.0;
+  }
+  else if (hv.total() == 21) {
+    // Player must stand on 21
+    ev = stand_ev<R>(dealer_hand, 21, card_counts, ctx);
+  }
+  else {
+    // Player chooses the better of Standing or Hitting again
+    double ev_stand = stand_ev<R>(dealer_hand, hv.total(), card_counts, ctx);
+    double ev_hit_again = hit_ev<R>(dealer_hand, hv, card_counts, ctx);
+
+    // The player will always pick the move with higher EV
+    ev = std::max(ev_stand, ev_hit_again);
+  }
+  card_counts[v]++;
+  return ev;
+}
+
 // Recursively compute the Expected Value (EV) of choosing to hit.
 //
 // After drawing one card, the player continues optimally by choosing the
-// higher-EV action (stand vs hit again) until the hand ends.
+// higher-EV action (stand vs hit again) until the hand ends. The EV only
+// depends on the player's total and soft flag, the dealer's hand and the
+// remaining shoe, so results are stored in the transposition table and
+// reused whenever another draw order reaches the same state.
 //
 // Parameters:
 //   dealer_hand  - Dealer's current hand.
 //   player_hand  - Player's current hand before drawing a card.
-//   card_counts  - Remaining card counts in the shoe.
-//   rules        - Blackjack table rules.
+//   card_counts  - Remaining card counts in the shoe. Temporarily modified
+//                  during recursion and restored before returning.
+//   ctx          - Table rules and caches for this query.
 //
-double eval_hit_c(std::vector<Card> dealer_hand, std::vector<Card> player_hand,
-                  std::array<int, 12> card_counts, const BlackjackRules& rules) {
+template <class R>
+static double hit_ev(const HandState& dealer_hand, const HandState& player_hand,
+                     std::array<int, 12>& card_counts, EvContext& ctx) {
+
+  // Reuse the result if this state was already reached
+  DealerKey key = make_ev_key(EvKind::HIT, player_hand.total(), player_hand.soft(),
+                              dealer_hand.total(), dealer_hand.soft(),
+                              known_no_natural(dealer_hand, ctx), card_counts);
+  double cached;
+  if (ctx.table.probe(key, cached)) {
+    PROFILE_COUNT(EV_CACHE_HITS);
+    return cached;
+  }
+  PROFILE_COUNT(EV_NODES);
 
   double expected_value = 0.0;
 
@@ -161,41 +236,331 @@ double eval_hit_c(std::vector<Card> dealer_hand, std::vector<Card> player_hand,
     if (card_counts[v] > 0) {
       // Calculate probability of drawing a card
       double p_card = static_cast<double>(card_counts[v]) / total_cards;
+      expected_value += p_card * hit_branch_ev<R>(dealer_hand, player_hand, v,
+                                                  card_counts, ctx);
+    }
+  }
 
-      Card card;
-      card = create_card_helper(v);
+  ctx.table.store(key, expected_value);
+  return expected_value;
+}
 
-      // Add the drawn card to the player's hand
-      player_hand.push_back(card);
+// EV of playing one post-split hand optimally once its second card is in.
+//
+// The hand may stand, hit (unless it holds split Aces and the rules forbid
+// hitting them) or double (only if doubling after a split is allowed);
+// resplitting is handled by split_ev.
+template <class R>
+static double post_split_hand_ev(const HandState& dealer_hand,
+                                 const HandState& hand, bool split_aces,
+                                 std::array<int, 12>& card_counts,
+                                 EvContext& ctx) {
+  double best = stand_ev<R>(dealer_hand, hand.total(), card_counts, ctx);
+
+  if (R::can_hit(split_aces)) {
+    if (hand.total() < 21) {
+      best = std::max(best, hit_ev<R>(dealer_hand, hand, card_counts, ctx));
+    }
+    if (R::can_double(hand, true)) {
+      best = std::max(best, double_ev<R>(dealer_hand, hand, card_counts, ctx));
+    }
+  }
 
-      // Evaluate player's total after the card draw
-      HandVal hv = evaluate_hand_c(player_hand);
-      auto next_counts = card_counts;
-      next_counts[v]--;
+  return best;
+}
 
-      if (hv.total > 21) {
-        // Player busts: loses 1 unit
-        expected_value += p_card * -1.0;
-      }
-      else if (hv.total == 21) {
-        // Player must stand on 21
-        expected_value += p_card * eval_stand_c(dealer_hand, 21, next_counts, rules);
-      }
-      else {
-        // Player chooses the better of Standing or Hitting again
-        double ev_stand = eval_stand_c(dealer_hand, hv.total, next_counts, rules);
-        double ev_hit_again = eval_hit_c(dealer_hand, player_hand, next_counts, rules);
+// Expected number of finished split hands, by how they finished.
+//
+// Parameters:
+//   pending      - Hands that still hold a single pair card.
+//   hands        - Hands in play so far.
+//   max_hands    - Largest number of hands the rules allow.
+//   can_resplit  - Whether a drawn pair card may be split again.
+//   p_pair       - Probability of drawing another pair card.
+//   n_other      - Incremented by the expected number of hands finished
+//                  with a non-pair second card.
+//   n_pair       - Incremented by the expected number of hands finished
+//                  with a pair card that could not be split.
+//   weight       - Probability of reaching this state.
+//
+static void count_split_hands(int pending, int hands, int max_hands,
+                              bool can_resplit, double p_pair,
+                              double& n_other, double& n_pair, double weight) {
+  if (pending == 0 || weight == 0.0) return;
+
+  if (can_resplit && hands < max_hands) {
+    // A pair card is split again: one more pending hand and one more hand
+    count_split_hands(pending + 1, hands + 1, max_hands, can_resplit, p_pair,
+                      n_other, n_pair, weight * p_pair);
+  } else {
+    n_pair += weight * p_pair;
+    count_split_hands(pending - 1, hands, max_hands, can_resplit, p_pair,
+                      n_other, n_pair, weight * p_pair);
+  }
 
-        // The player will always pick the move with higher EV
-        expected_value += p_card * std::max(ev_stand, ev_hit_again);
-      }
+  n_other += weight * (1.0 - p_pair);
+  count_split_hands(pending - 1, hands, max_hands, can_resplit, p_pair,
+                    n_other, n_pair, weight * (1.0 - p_pair));
+}
 
-      // Undo mutation for the next loop iteration
-      player_hand.pop_back();
+// Compute the Expected Value (EV) of splitting a pair.
+//
+// Rather than enumerating the joint tree of every split hand, the EV of a
+// single post-split hand is computed once for each possible second card
+// and reused for every hand of the split. Resplitting is modelled by the
+// expected number of hands that end up with a non-pair second card (played
+// optimally, with doubling only under double_after_split) and with a pair
+// card that can no longer be split (max_splits reached, or Aces without
+// resplit_aces), which are then weighted by those two hand EVs. A hand
+// with second card `v` is evaluated against the composition left after
+// the original pair, the dealer's cards and that `v` are removed; cards
+// dealt to the other hands of the split are not removed, which keeps the
+// cost to a handful of hit/double queries even for max_splits = 3 on
+// multi-deck shoes.
+//
+// Parameters:
+//   dealer_hand - Dealer's current hand.
+//   pair_value  - Value of each card of the pair (2-11).
+//   card_counts - Remaining card counts, excluding the pair. Temporarily
+//                 modified and restored before returning.
+//   ctx         - Table rules and caches for this query; the rules must
+//                 allow at least one split.
+//
+// Returns:
+//   The EV of splitting, in units of the original bet.
+//
+template <class R>
+static double split_ev(const HandState& dealer_hand, int pair_value,
+                       std::array<int, 12>& card_counts, EvContext& ctx) {
+  const BlackjackRules& rules = ctx.rules;
+
+  bool aces = (pair_value == 11);
+  double total_cards = 0;
+  for (int i = 2; i <= 11; ++i) total_cards += card_counts[i];
+
+  double p_pair = card_counts[pair_value] / total_cards;
+  double ev_other = 0.0;  // EV of a hand whose second card is not a pair card
+  double ev_pair = 0.0;   // EV of a hand holding an unsplittable pair
+
+  for (int v = 2; v <= 11; ++v) {
+    if (card_counts[v] > 0) {
+      double p_card = static_cast<double>(card_counts[v]) / total_cards;
+
+      HandState hand = empty_hand();
+      hand.add(pair_value);
+      hand.add(v);
+      card_counts[v]--;
+      double ev = post_split_hand_ev<R>(dealer_hand, hand, aces, card_counts, ctx);
+      card_counts[v]++;
+      if (v == pair_value) ev_pair = ev;
+      else ev_other += p_card * ev;
     }
   }
+  if (p_pair < 1.0) ev_other /= (1.0 - p_pair);
 
-  return expected_value;
+  double n_other = 0.0;
+  double n_pair = 0.0;
+  bool can_resplit = !aces || rules.resplit_aces;
+  count_split_hands(2, 2, rules.max_splits + 1, can_resplit, p_pair,
+                    n_other, n_pair, 1.0);
+
+  return n_other * ev_other + n_pair * ev_pair;
+}
+
+// Public entry points. The kernels above take the table rules as a
+// RuleSet template parameter `R`; the instantiation is picked once here,
+// so the recursion itself never branches on a rule.
+
+double eval_stand_c(const HandState& dealer_hand, int player_total,
+                    std::array<int, 12>& card_counts, EvContext& ctx) {
+  return dispatch_rules(ctx.rules, [&](auto rule_set) {
+    return stand_ev<decltype(rule_set)>(dealer_hand, player_total, card_counts, ctx);
+  });
+}
+
+double eval_double_c(const HandState& dealer_hand, const HandState& player_hand,
+                     std::array<int, 12>& card_counts, EvContext& ctx) {
+  return dispatch_rules(ctx.rules, [&](auto rule_set) {
+    return double_ev<decltype(rule_set)>(dealer_hand, player_hand, card_counts, ctx);
+  });
+}
+
+double eval_hit_c(const HandState& dealer_hand, const HandState& player_hand,
+                  std::array<int, 12>& card_counts, EvContext& ctx) {
+  return dispatch_rules(ctx.rules, [&](auto rule_set) {
+    return hit_ev<decltype(rule_set)>(dealer_hand, player_hand, card_counts, ctx);
+  });
+}
+
+// Callers must check that the rules allow splitting (max_splits >= 1)
+// and report the split as unavailable otherwise.
+double eval_split_c(const HandState& dealer_hand, int pair_value,
+                    std::array<int, 12>& card_counts, EvContext& ctx) {
+  if (ctx.rules.max_splits < 1) Rcpp::stop("the rules allow no splits (max_splits is 0)");
+  return dispatch_rules(ctx.rules, [&](auto rule_set) {
+    return split_ev<decltype(rule_set)>(dealer_hand, pair_value, card_counts, ctx);
+  });
+}
+
+// Evaluate several actions of one hand on a work-stealing pool.
+//
+// The work is cut one level below the root: the split EV, each card the
+// player can draw when hitting or doubling, and the stand EV are separate
+// tasks, run against the EvContext of whichever worker picks them up. The
+// draw branches are then combined in card order with the same arithmetic
+// as hit_ev and double_ev. Every cached value is an exact function of its
+// state, so results are bit-identical to the serial eval_*_c calls for
+// any thread count or schedule; workers just do not share transpositions.
+//
+// Parameters:
+//   dealer_hand - Dealer's current hand.
+//   player_hand - Player's current hand.
+//   card_counts - Remaining card counts in the shoe.
+//   actions     - Actions to evaluate; only STAND, HIT, DOUBLE and SPLIT
+//                 are computed here.
+//   contexts    - One EvContext per worker, all with the same rules.
+//
+// Returns:
+//   EVs of the requested actions, NaN for the others (and for split
+//   unless the hand is a pair and the rules allow a split).
+//
+CellEvs eval_actions_c(const HandState& dealer_hand, const HandState& player_hand,
+                       const std::array<int, 12>& card_counts,
+                       const std::vector<Action>& actions,
+                       const std::vector<EvContext*>& contexts) {
+  const double nan = std::nan("");
+  CellEvs evs{nan, nan, nan, nan, nan};
+  bool want[5] = {false, false, false, false, false};
+  for (Action action : actions) want[static_cast<int>(action)] = true;
+
+  const EvContext& rules_ctx = *contexts[0];
+  double total_cards = 0;
+  for (int i = 2; i <= 11; ++i) total_cards += card_counts[i];
+
+  std::array<double, 12> hit_branch;
+  std::array<double, 12> double_branch;
+  std::vector<std::function<void(int)>> tasks;
+
+  // Most expensive first: split, then the draw branches, then stand
+  if (want[static_cast<int>(Action::SPLIT)] && player_hand.pair &&
+      rules_ctx.rules.max_splits >= 1) {
+    tasks.push_back([&](int worker) {
+      std::array<int, 12> counts = card_counts;
+      evs.split = eval_split_c(dealer_hand, player_hand.first_value, counts, *contexts[worker]);
+    });
+  }
+  for (int v = 2; v <= 11; ++v) {
+    if (card_counts[v] == 0) continue;
+    if (want[static_cast<int>(Action::HIT)]) {
+      tasks.push_back([&, v](int worker) {
+        std::array<int, 12> counts = card_counts;
+        hit_branch[v] = dispatch_rules(rules_ctx.rules, [&](auto rule_set) {
+          return hit_branch_ev<decltype(rule_set)>(dealer_hand, player_hand, v, counts,
+                                                   *contexts[worker]);
+        });
+      });
+    }
+    if (want[static_cast<int>(Action::DOUBLE)]) {
+      tasks.push_back([&, v](int worker) {
+        std::array<int, 12> counts = card_counts;
+        double_branch[v] = dispatch_rules(rules_ctx.rules, [&](auto rule_set) {
+          return double_branch_ev<decltype(rule_set)>(dealer_hand, player_hand, v, counts,
+                                                      *contexts[worker]);
+        });
+      });
+    }
+  }
+  if (want[static_cast<int>(Action::STAND)]) {
+    tasks.push_back([&](int worker) {
+      std::array<int, 12> counts = card_counts;
+      evs.stand = eval_stand_c(dealer_hand, player_hand.total(), counts, *contexts[worker]);
+    });
+  }
+
+  run_tasks(tasks, static_cast<int>(contexts.size()));
+
+  if (want[static_cast<int>(Action::HIT)]) evs.hit = 0.0;
+  if (want[static_cast<int>(Action::DOUBLE)]) evs.dbl = 0.0;
+  for (int v = 2; v <= 11; ++v) {
+    if (card_counts[v] == 0) continue;
+    double p_card = static_cast<double>(card_counts[v]) / total_cards;
+    if (want[static_cast<int>(Action::HIT)]) evs.hit += p_card * hit_branch[v];
+    if (want[static_cast<int>(Action::DOUBLE)]) evs.dbl += p_card * double_branch[v];
+  }
+  return evs;
+}
+
+#ifndef BLACKJACK_STANDALONE
+// EV contexts of one kind of query, one per worker thread, each using
+// `bytes` of cache.
+struct EvContextPool {
+  std::vector<std::unique_ptr<EvContext>> contexts;
+  std::size_t bytes;
+};
+
+// Contexts kept between queries when the caller asks for it.
+//
+// Cached values are keyed by the full remaining composition, so they stay
+// valid for any later query on the same shoe as long as the rules and
+// memory budget are unchanged.
+static EvContextPool persistent_pool;
+// Contexts of the other queries. Their tables are cleared rather than
+// reallocated at each call, which skips the allocation and page faults
+// of a fresh budget.
+static EvContextPool scratch_pool;
+
+// Return `n` contexts of `pool` for `rules` with `bytes` of cache each,
+// rebuilding the pool if it was made for other rules or another budget.
+static std::vector<EvContext*> pool_contexts(EvContextPool& pool,
+                                             const BlackjackRules& rules,
+                                             std::size_t bytes, int n) {
+  if (!pool.contexts.empty() &&
+      (pool.bytes != bytes || !same_rules(pool.contexts[0]->rules, rules))) {
+    pool.contexts.clear();
+  }
+  pool.bytes = bytes;
+  while (static_cast<int>(pool.contexts.size()) < n) {
+    pool.contexts.emplace_back(new EvContext(rules, bytes));
+  }
+  std::vector<EvContext*> out;
+  for (int t = 0; t < n; ++t) out.push_back(pool.contexts[t].get());
+  return out;
+}
+
+// Release the EV contexts kept by earlier queries.
+// [[Rcpp::export]]
+void clear_ev_cache_rcpp() {
+  persistent_pool.contexts.clear();
+  scratch_pool.contexts.clear();
+}
+
+// Infinite-deck EVs for the actions requested by get_specific_evs_rcpp.
+static Rcpp::List infinite_deck_evs(const BlackjackRules& rules,
+                                    const HandState& player_hand,
+                                    const HandState& dealer_hand,
+                                    Rcpp::CharacterVector actions) {
+  bool s17 = rules.dealer_stands_soft_17;
+  Rcpp::List ev_results;
+  for (int i = 0; i < actions.size(); ++i) {
+    std::string action = Rcpp::as<std::string>(actions[i]);
+    if (action == "stand") {
+      ev_results["stand"] = infinite_stand_ev_c(dealer_hand, player_hand.total(), s17);
+    } else if (action == "hit") {
+      ev_results["hit"] = infinite_hit_ev_c(dealer_hand, player_hand, s17);
+    } else if (action == "double") {
+      ev_results["double"] = infinite_double_ev_c(dealer_hand, player_hand, s17);
+    } else if (action == "split") {
+      ev_results["split"] = player_hand.pair && rules.max_splits >= 1
+        ? infinite_split_ev_c(dealer_hand, player_hand.first_value, rules)
+        : NA_REAL;
+    } else if (action == "surrender") {
+      ev_results["surrender"] = eval_surrender_c();
+    } else if (action == "insure") {
+      // The hole card is a ten with probability 4/13
+      ev_results["insure"] = 3.0 * 4.0 / 13.0 - 1.0;
+    }
+  }
+  return ev_results;
 }
 
 // Compute Expected Values (EVs) for a specified set of player actions.
@@ -206,27 +571,82 @@ double eval_hit_c(std::vector<Card> dealer_hand, std::vector<Card> player_hand,
 //   dealer_hand_df   - R data.frame with the dealer's current hand.
 //   card_counts_r    - Integer vector of remaining card counts by value.
 //   actions          - Character vector of actions to evaluate
-//                      (e.g., "stand", "hit", "double", "surrender", "insure").
+//                      (e.g., "stand", "hit", "double", "split", "surrender",
+//                      "insure"). "split" is NA unless the hand is a pair
+//                      and the rules allow splitting.
+//   cache_mb         - Memory budget in megabytes for the EV caches,
+//                      split evenly between the worker threads.
+//   keep_cache       - If true, keep the caches after this call so later
+//                      queries with the same rules, budget and thread
+//                      count can reuse them. Otherwise the caches start
+//                      empty; their memory is still kept for the next
+//                      call until clear_ev_cache_rcpp.
+//   infinite_deck    - If true (or if the rules ask for it), answer from
+//                      the infinite-deck tables and ignore card_counts.
+//   n_threads        - Number of worker threads; 0 uses every available
+//                      core. Above 1, the actions and the first card drawn
+//                      by hit and double are evaluated in parallel (see
+//                      eval_actions_c), with identical results.
 //
 // [[Rcpp::export]]
 Rcpp::List get_specific_evs_rcpp(Rcpp::List rules_obj,
                            Rcpp::DataFrame player_hand_df,
                            Rcpp::DataFrame dealer_hand_df,
                            Rcpp::IntegerVector card_counts_r,
-                           Rcpp::CharacterVector actions) {
+                           Rcpp::CharacterVector actions,
+                           double cache_mb = 64,
+                           bool keep_cache = false,
+                           bool infinite_deck = false,
+                           int n_threads = 1) {
+  PROFILE_SCOPE(EV_QUERY);
 
   // Parse blackjack rules from R into a C++ rules struct
   BlackjackRules rules = parse_rules(rules_obj);
-  // Convert R data.frames into C++ card vectors
-  std::vector<Card> player_hand = df_to_cards(player_hand_df);
-  std::vector<Card> dealer_hand = df_to_cards(dealer_hand_df);
+  // Convert R data.frames into C++ hand states
+  HandState player_hand = hand_state_c(df_to_cards(player_hand_df));
+  HandState dealer_hand = hand_state_c(df_to_cards(dealer_hand_df));
   // Copy remaining card counts into a fixed-size C++ array
   std::array<int, 12> card_counts;
   for(int i = 0; i < 12; ++i) card_counts[i] = card_counts_r[i];
 
+  if (!(cache_mb > 0)) Rcpp::stop("cache_mb must be positive");
+
+  if (infinite_deck || rules.infinite_deck) {
+    return infinite_deck_evs(rules, player_hand, dealer_hand, actions);
+  }
+
+  // One context per worker thread, sharing the budget. Caches are shared
+  // by every action evaluated below, and by later calls if the caller
+  // keeps them
+  if (n_threads <= 0) n_threads = std::max(1u, std::thread::hardware_concurrency());
+  std::size_t cache_bytes = static_cast<std::size_t>(cache_mb * 1024 * 1024) / n_threads;
+  std::vector<EvContext*> contexts =
+    pool_contexts(keep_cache ? persistent_pool : scratch_pool, rules, cache_bytes, n_threads);
+  if (!keep_cache) {
+    for (EvContext* c : contexts) {
+      c->dealer.clear();
+      c->table.clear();
+    }
+  }
+  EvContext* ctx = contexts[0];
+
+  // Stand, hit, double and split on the task pool
+  CellEvs parallel_evs;
+  if (n_threads > 1) {
+    std::vector<Action> wanted;
+    for (int i = 0; i < actions.size(); ++i) {
+      std::string action = Rcpp::as<std::string>(actions[i]);
+      if (action == "stand") wanted.push_back(Action::STAND);
+      else if (action == "hit") wanted.push_back(Action::HIT);
+      else if (action == "double") wanted.push_back(Action::DOUBLE);
+      else if (action == "split") wanted.push_back(Action::SPLIT);
+    }
+
+    parallel_evs = eval_actions_c(dealer_hand, player_hand, card_counts, wanted, contexts);
+  }
+
   // Container for EV results keyed by action name
   Rcpp::List ev_results;
-  HandVal player_hv = evaluate_hand_c(player_hand);
 
   // Loop over requested actions and compute EV for each
   for(int i = 0; i < actions.size(); ++i) {
@@ -234,16 +654,27 @@ Rcpp::List get_specific_evs_rcpp(Rcpp::List rules_obj,
 
     if (action == "stand") {
       // EV if the player stands immediately
-      ev_results["stand"] = eval_stand_c(dealer_hand, player_hv.total,
-                                          card_counts, rules);
+      ev_results["stand"] = n_threads > 1 ? parallel_evs.stand
+        : eval_stand_c(dealer_hand, player_hand.total(), card_counts, *ctx);
     }
     else if (action == "hit") {
       // EV if the player hits and then plays optimally
-      ev_results["hit"] = eval_hit_c(dealer_hand, player_hand, card_counts, rules);
+      ev_results["hit"] = n_threads > 1 ? parallel_evs.hit
+        : eval_hit_c(dealer_hand, player_hand, card_counts, *ctx);
     }
     else if (action == "double") {
       // EV if the player doubles down (one card then stand)
-      ev_results["double"] = eval_double_c(dealer_hand, player_hand, card_counts, rules);
+      ev_results["double"] = n_threads > 1 ? parallel_evs.dbl
+        : eval_double_c(dealer_hand, player_hand, card_counts, *ctx);
+    }
+    else if (action == "split") {
+      // EV if the player splits the pair and plays each hand optimally
+      double ev = NA_REAL;
+      if (player_hand.pair && rules.max_splits >= 1) {
+        ev = n_threads > 1 ? parallel_evs.split
+          : eval_split_c(dealer_hand, player_hand.first_value, card_counts, *ctx);
+      }
+      ev_results["split"] = ev;
     }
     else if (action == "surrender") {
       // EV of surrender (fixed at -0.5 units)
@@ -259,3 +690,159 @@ Rcpp::List get_specific_evs_rcpp(Rcpp::List rules_obj,
 }
 
 
+// Actions understood by the batch EV interface.
+enum class BatchAction {
+  STAND,
+  HIT,
+  DOUBLE,
+  SPLIT,
+  SURRENDER,
+  INSURE
+};
+
+// Build a hand from one row of an integer-coded card matrix.
+//
+// Parameters:
+//   cards - Pointer to the matrix data (column-major, as stored by R).
+//   nrow  - Number of rows in the matrix.
+//   ncol  - Number of columns (maximum cards per hand).
+//   row   - Row to read.
+//
+// Returns:
+//   The hand made of the row's card values (2-11); 0 or NA ends the hand.
+//
+static HandState hand_from_row(const int* cards, int nrow, int ncol, int row) {
+  HandState hand = empty_hand();
+  for (int col = 0; col < ncol; ++col) {
+    int v = cards[row + col * nrow];
+    if (v == NA_INTEGER || v == 0) break;
+    if (v < 2 || v > 11) Rcpp::stop("card values must be between 2 and 11");
+    hand.add(v);
+  }
+  return hand;
+}
+
+// Compute EVs for many situations in a single call.
+//
+// Rules and action names are parsed once, hands are read straight from
+// integer matrices without building data frames or Card vectors, and one
+// EvContext is shared by every row, so situations that reach the same
+// dealer state and composition reuse each other's work.
+//
+// Parameters:
+//   rules_obj    - R list representing a blackjack_rules object.
+//   player_cards - N x k integer matrix of the player's card values (2-11,
+//                  Ace = 11), one hand per row; unused trailing entries
+//                  are 0 or NA.
+//   dealer_cards - N x m integer matrix of the dealer's card values, coded
+//                  the same way (usually a single upcard column).
+//   card_counts  - N x 12 integer matrix of remaining card counts; row i
+//                  is laid out like card_counts_r in get_specific_evs_rcpp.
+//   actions      - Character vector of actions to evaluate ("stand", "hit",
+//                  "double", "split", "surrender", "insure").
+//   cache_mb     - Memory budget in megabytes for the EV caches.
+//   infinite_deck - If true (or if the rules ask for it), answer from the
+//                   infinite-deck tables and ignore card_counts.
+//
+// Returns:
+//   An N x length(actions) numeric matrix of EVs, with NA where an action
+//   is not available (e.g. "split" for a non-pair).
+//
+// [[Rcpp::export]]
+Rcpp::NumericMatrix get_batch_evs_rcpp(Rcpp::List rules_obj,
+                                       Rcpp::IntegerMatrix player_cards,
+                                       Rcpp::IntegerMatrix dealer_cards,
+                                       Rcpp::IntegerMatrix card_counts,
+                                       Rcpp::CharacterVector actions,
+                                       double cache_mb = 64,
+                                       bool infinite_deck = false) {
+  PROFILE_SCOPE(EV_QUERY);
+  BlackjackRules rules = parse_rules(rules_obj);
+  if (!(cache_mb > 0)) Rcpp::stop("cache_mb must be positive");
+  bool infinite = infinite_deck || rules.infinite_deck;
+  bool s17 = rules.dealer_stands_soft_17;
+
+  int n = player_cards.nrow();
+  if (dealer_cards.nrow() != n || card_counts.nrow() != n) {
+    Rcpp::stop("player_cards, dealer_cards and card_counts must have the same number of rows");
+  }
+  if (card_counts.ncol() != 12) Rcpp::stop("card_counts must have 12 columns");
+
+  // Parse action names once
+  int n_actions = actions.size();
+  std::vector<BatchAction> codes(n_actions);
+  for (int a = 0; a < n_actions; ++a) {
+    std::string action = Rcpp::as<std::string>(actions[a]);
+    if (action == "stand") codes[a] = BatchAction::STAND;
+    else if (action == "hit") codes[a] = BatchAction::HIT;
+    else if (action == "double") codes[a] = BatchAction::DOUBLE;
+    else if (action == "split") codes[a] = BatchAction::SPLIT;
+    else if (action == "surrender") codes[a] = BatchAction::SURRENDER;
+    else if (action == "insure") codes[a] = BatchAction::INSURE;
+    else Rcpp::stop("unknown action: " + action);
+  }
+
+  // Read the R matrices in place (column-major)
+  const int* player_ptr = player_cards.begin();
+  const int* dealer_ptr = dealer_cards.begin();
+  const int* counts_ptr = card_counts.begin();
+  int player_cols = player_cards.ncol();
+  int dealer_cols = dealer_cards.ncol();
+
+  // The infinite-deck tables need no caches
+  std::unique_ptr<EvContext> ctx;
+  if (!infinite) ctx.reset(new EvContext(rules, static_cast<std::size_t>(cache_mb * 1024 * 1024)));
+  Rcpp::NumericMatrix out(n, n_actions);
+  double* out_ptr = out.begin();
+
+  for (int i = 0; i < n; ++i) {
+    HandState player_hand = hand_from_row(player_ptr, n, player_cols, i);
+    HandState dealer_hand = hand_from_row(dealer_ptr, n, dealer_cols, i);
+
+    std::array<int, 12> counts;
+    double total = 0.0;
+    for (int v = 0; v < 12; ++v) {
+      counts[v] = counts_ptr[i + v * n];
+      if (v >= 2) total += counts[v];
+    }
+
+    for (int a = 0; a < n_actions; ++a) {
+      double ev = NA_REAL;
+      switch (codes[a]) {
+        case BatchAction::STAND:
+          ev = infinite ? infinite_stand_ev_c(dealer_hand, player_hand.total(), s17)
+                        : eval_stand_c(dealer_hand, player_hand.total(), counts, *ctx);
+          break;
+        case BatchAction::HIT:
+          ev = infinite ? infinite_hit_ev_c(dealer_hand, player_hand, s17)
+                        : eval_hit_c(dealer_hand, player_hand, counts, *ctx);
+          break;
+        case BatchAction::DOUBLE:
+          ev = infinite ? infinite_double_ev_c(dealer_hand, player_hand, s17)
+                        : eval_double_c(dealer_hand, player_hand, counts, *ctx);
+          break;
+        case BatchAction::SPLIT:
+          if (player_hand.pair && rules.max_splits >= 1) {
+            ev = infinite
+              ? infinite_split_ev_c(dealer_hand, player_hand.first_value, rules)
+              : eval_split_c(dealer_hand, player_hand.first_value, counts, *ctx);
+          }
+          break;
+        case BatchAction::SURRENDER:
+          ev = eval_surrender_c();
+          break;
+        case BatchAction::INSURE:
+          // Insurance pays 2:1 when the hole card is a ten
+          ev = infinite ? 3.0 * 4.0 / 13.0 - 1.0 : 3.0 * counts[10] / total - 1.0;
+          break;
+      }
+      out_ptr[i + a * n] = ev;
+    }
+
+    if ((i & 1023) == 0) Rcpp::checkUserInterrupt();
+  }
+
+  Rcpp::colnames(out) = actions;
+  return out;
+}
+#endif
@@ -1,13 +1,19 @@
 #include "blackjack.h"
 
+#ifndef BLACKJACK_STANDALONE
  /* Converts an R 'blackjack_rules' S3 object (which is internally a List)
  * into a C++ BlackjackRules struct.
  */
 BlackjackRules parse_rules(Rcpp::List rules) {
+  PROFILE_SCOPE(PARSE_RULES);
   BlackjackRules rules_c;
 
   rules_c.dealer_stands_soft_17 = Rcpp::as<bool>(rules["dealer_stands_soft_17"]);
   rules_c.num_decks             = Rcpp::as<int>(rules["num_decks"]);
+  // Larger shoes would overflow the card counts packed into cache keys
+  if (rules_c.num_decks < 1 || rules_c.num_decks > MAX_DECKS) {
+    Rcpp::stop("num_decks must be between 1 and %d", MAX_DECKS);
+  }
   rules_c.allow_insurance       = Rcpp::as<bool>(rules["allow_insurance"]);
   rules_c.dealer_peeks          = Rcpp::as<bool>(rules["dealer_peeks"]);
   rules_c.double_after_split    = Rcpp::as<bool>(rules["double_after_split"]);
@@ -24,40 +30,181 @@ BlackjackRules parse_rules(Rcpp::List rules) {
     rules_c.double_on = DoubleRule::TEN_ELEVEN;
   }
 
+  rules_c.payout      = Rcpp::as<double>(rules["payout"]);
+  rules_c.penetration = Rcpp::as<double>(rules["penetration"]);
+  rules_c.burn_cards  = Rcpp::as<int>(rules["burn_cards"]);
+
+  std::string surrender_val = Rcpp::as<std::string>(rules["surrender"]);
+  if (surrender_val == "early") {
+    rules_c.surrender = SurrenderRule::EARLY;
+  } else if (surrender_val == "late") {
+    rules_c.surrender = SurrenderRule::LATE;
+  } else {
+    rules_c.surrender = SurrenderRule::NONE;
+  }
+
+  // Optional, so rule objects created before the field existed still parse
+  rules_c.infinite_deck = rules.containsElementNamed("infinite_deck") &&
+    Rcpp::as<bool>(rules["infinite_deck"]);
+
+  if (rules_c.max_splits < 0 || rules_c.max_splits > MAX_HANDS - 1) {
+    Rcpp::stop("max_splits must be between 0 and %d", MAX_HANDS - 1);
+  }
+
   return rules_c;
 }
 
+// Convert an R integer matrix of action codes into a Strategy.
+//
+// Parameters:
+//   strategy - A NUM_HAND_CLASSES x (10 * n_bins) integer matrix. Rows are
+//              hand classes (hard 4-21, soft 12-21, pairs 2-A) and each
+//              block of 10 columns holds dealer upcards 2 through Ace for
+//              one true-count bin. Entries are strategy cells: an Action
+//              code (0 = stand, 1 = hit, 2 = double, 3 = split,
+//              4 = surrender), optionally with a fallback as produced by
+//              compile_strategy_rcpp. Split is only allowed in the pair
+//              rows. Fallbacks must be stand or hit, or split for a
+//              surrender cell in a pair row. With more than one bin the
+//              matrix needs a "tc_breaks" attribute of n_bins - 1
+//              ascending true counts.
+//
+// Returns:
+//   The strategy as a dense lookup table.
+//
+Strategy parse_strategy(Rcpp::IntegerMatrix strategy) {
+  PROFILE_SCOPE(PARSE_STRATEGY);
+  if (strategy.nrow() != NUM_HAND_CLASSES || strategy.ncol() < 10 ||
+      strategy.ncol() % 10 != 0) {
+    Rcpp::stop("strategy must be a %d x (10 * bins) matrix", NUM_HAND_CLASSES);
+  }
+
+  Strategy strategy_c;
+  strategy_c.n_bins = strategy.ncol() / 10;
+  if (strategy_c.n_bins > 1) {
+    Rcpp::NumericVector breaks = strategy.attr("tc_breaks");
+    if (breaks.size() != strategy_c.n_bins - 1) {
+      Rcpp::stop("strategy with %d true-count bins needs %d tc_breaks",
+                 strategy_c.n_bins, strategy_c.n_bins - 1);
+    }
+    for (int i = 0; i < breaks.size(); ++i) {
+      if (i > 0 && !(breaks[i] > breaks[i - 1])) {
+        Rcpp::stop("tc_breaks must be strictly increasing");
+      }
+      strategy_c.tc_breaks.push_back(breaks[i]);
+    }
+  }
+
+  strategy_c.actions.resize(strategy_c.n_bins * NUM_HAND_CLASSES * 10);
+  for (int bin = 0; bin < strategy_c.n_bins; ++bin) {
+    for (int row = 0; row < NUM_HAND_CLASSES; ++row) {
+      for (int col = 0; col < 10; ++col) {
+        int code = strategy(row, bin * 10 + col);
+        if (code < 0 || code > 0xFF || (code & 0x0F) > static_cast<int>(Action::SURRENDER)) {
+          Rcpp::stop("invalid action code %d in strategy", code);
+        }
+        std::uint8_t cell = static_cast<std::uint8_t>(code);
+        if (cell_action(cell) == Action::SPLIT && row < NUM_HAND_CLASSES - 10) {
+          Rcpp::stop("split is only allowed in pair rows (" + hand_class_label(row) + ")");
+        }
+        Action fallback = cell_fallback(cell);
+        bool split_fallback = fallback == Action::SPLIT &&
+          cell_action(cell) == Action::SURRENDER && row >= NUM_HAND_CLASSES - 10;
+        if (fallback != Action::STAND && fallback != Action::HIT && !split_fallback) {
+          Rcpp::stop("invalid fallback in action code " + std::to_string(code) + " for " +
+                     hand_class_label(row) + " (must be stand or hit, or split for "
+                     "a surrender cell of a pair)");
+        }
+        strategy_c.actions[(bin * NUM_HAND_CLASSES + row) * 10 + col] = cell;
+      }
+    }
+  }
+
+  return strategy_c;
+}
+
+// Rank and suit names used at the R boundary, indexed like the Card code.
+static const char* const RANK_NAMES[13] = {"A", "2", "3", "4", "5", "6", "7",
+                                           "8", "9", "10", "J", "Q", "K"};
+static const char* const SUIT_NAMES[4]  = {"♠", "♥", "♦", "♣"};
+
+// Label of a card, such as "10♥".
+std::string card_label(Card card) {
+  return std::string(RANK_NAMES[card_rank(card)]) + SUIT_NAMES[card_suit(card)];
+}
+
+// Look up the index of `name` in a table of names, or -1 if absent.
+static int name_index(const std::string& name, const char* const* names, int n) {
+  for (int i = 0; i < n; ++i) {
+    if (name == names[i]) return i;
+  }
+  return -1;
+}
+
 // Convert an R data frame of cards into a C++ vector of Card objects.
 //
 // Parameters:
 //   df - An R data.frame representing a hand or set of cards. Expected to contain
-//   columns: rank (character), suit (character), value (integer)
+//   columns: rank (character) and suit (character). The card's value is
+//   implied by its rank.
 //
 // Returns:
 //   A std::vector<Card> containing the converted cards.
 //
 std::vector<Card> df_to_cards(Rcpp::DataFrame df) {
+  PROFILE_SCOPE(DF_TO_CARDS);
   // Extract columns from the DataFrame as Rcpp vectors
   Rcpp::CharacterVector ranks = df["rank"];
   Rcpp::CharacterVector suits = df["suit"];
-  Rcpp::IntegerVector values  = df["value"];
 
   int n = df.nrows();
   std::vector<Card> hand;
   hand.reserve(n);
 
-  // Build Card objects row by row
+  // Encode each row's rank and suit into a one-byte card
   for(int i = 0; i < n; ++i) {
-    Card c;
-    c.rank  = Rcpp::as<std::string>(ranks[i]);
-    c.suit  = Rcpp::as<std::string>(suits[i]);
-    c.value = values[i];
-    hand.push_back(c);
+    std::string rank_str = Rcpp::as<std::string>(ranks[i]);
+    std::string suit_str = Rcpp::as<std::string>(suits[i]);
+
+    int rank = name_index(rank_str, RANK_NAMES, 13);
+    int suit = name_index(suit_str, SUIT_NAMES, 4);
+    if (rank < 0) Rcpp::stop("Unknown card rank: " + rank_str);
+    if (suit < 0) Rcpp::stop("Unknown card suit: " + suit_str);
+
+    hand.push_back(make_card(rank, suit));
   }
 
   return hand;
 }
 
+// Convert a vector of Card objects into an R data frame for display.
+//
+// Parameters:
+//   cards - The cards to convert.
+//
+// Returns:
+//   A data.frame with columns rank (character), suit (character) and
+//   value (integer), one row per card.
+//
+Rcpp::DataFrame cards_to_df(const std::vector<Card>& cards) {
+  int n = static_cast<int>(cards.size());
+  Rcpp::CharacterVector ranks(n);
+  Rcpp::CharacterVector suits(n);
+  Rcpp::IntegerVector values(n);
+
+  for (int i = 0; i < n; ++i) {
+    ranks[i]  = RANK_NAMES[card_rank(cards[i])];
+    suits[i]  = SUIT_NAMES[card_suit(cards[i])];
+    values[i] = card_value(cards[i]);
+  }
+
+  return Rcpp::DataFrame::create(Rcpp::Named("rank") = ranks,
+                                 Rcpp::Named("suit") = suits,
+                                 Rcpp::Named("value") = values,
+                                 Rcpp::Named("stringsAsFactors") = false);
+}
+#endif
+
 // Determine whether the player may double down.
 //
 // Parameters:
@@ -69,26 +216,14 @@ std::vector<Card> df_to_cards(Rcpp::DataFrame df) {
 //   true  - if doubling is allowed under the current rules
 //   false - otherwise
 //
-bool can_double_c(const std::vector<Card>& player_hand,
+bool can_double_c(const HandState& player_hand,
                   const BlackjackRules& rules,
                   bool split_hand) {
-
-  if (player_hand.size() != 2) return false;
-  if (split_hand && !rules.double_after_split) return false;
-
-  HandVal hv = evaluate_hand_c(player_hand);
-  bool is_hard = !hv.soft;
-
-  switch (rules.double_on) {
-    case DoubleRule::ANY:
-      return true;
-    case DoubleRule::NINE_TEN_ELEVEN:
-      return is_hard && (hv.total >= 9 && hv.total <= 11);
-    case DoubleRule::TEN_ELEVEN:
-      return is_hard && (hv.total == 10 || hv.total == 11);
-    default:
-      return false;
-  }
+  // The rule logic lives in RuleSet::can_double so the templated kernels
+  // and this runtime check cannot drift apart
+  return dispatch_rules(rules, [&](auto rule_set) {
+    return decltype(rule_set)::can_double(player_hand, split_hand);
+  });
 }
 
 // Checks if a player is allowed to take another card (Hit)
@@ -102,7 +237,7 @@ bool can_double_c(const std::vector<Card>& player_hand,
 //   true  - if hitting is allowed under the current rules
 //   false - otherwise
 //
-bool can_hit_c(const std::vector<Card>& player_hand,
+bool can_hit_c(const HandState& player_hand,
                const BlackjackRules& rules,
                bool split_aces) {
 
@@ -114,3 +249,60 @@ bool can_hit_c(const std::vector<Card>& player_hand,
 
   return true;
 }
+
+// Find the strategy-table row for a hand.
+//
+// Parameters:
+//   hand     - The player's hand.
+//   use_pair - If true and the hand is a pair, return the pair row;
+//              otherwise the hand is classified by its total.
+//
+// Returns:
+//   A row index in [0, NUM_HAND_CLASSES).
+//
+int hand_class_c(const HandState& hand, bool use_pair) {
+  if (use_pair && hand.pair) return 28 + (hand.first_value - 2);
+  if (hand.soft()) return 18 + (hand.total() - 12);
+
+  int total = hand.total();
+  if (total < 4) total = 4;
+  if (total > 21) total = 21;
+  return total - 4;
+}
+
+// Display label for a strategy-table row, e.g. "H16", "S18", "P8" or "PA".
+//
+// Parameters:
+//   hand_class - A row index in [0, NUM_HAND_CLASSES).
+//
+// Returns:
+//   The row's label.
+//
+std::string hand_class_label(int hand_class) {
+  if (hand_class < 18) return "H" + std::to_string(hand_class + 4);
+  if (hand_class < 28) return "S" + std::to_string(hand_class - 18 + 12);
+
+  int value = hand_class - 28 + 2;
+  return (value == 11) ? "PA" : "P" + std::to_string(value);
+}
+
+// Check whether two rule sets are identical.
+//
+// Used to decide whether EVs cached under one rule set may be reused
+// for a query made under another.
+bool same_rules(const BlackjackRules& a, const BlackjackRules& b) {
+  return a.dealer_stands_soft_17 == b.dealer_stands_soft_17 &&
+    a.num_decks == b.num_decks &&
+    a.allow_insurance == b.allow_insurance &&
+    a.dealer_peeks == b.dealer_peeks &&
+    a.double_on == b.double_on &&
+    a.double_after_split == b.double_after_split &&
+    a.max_splits == b.max_splits &&
+    a.resplit_aces == b.resplit_aces &&
+    a.hit_split_aces == b.hit_split_aces &&
+    a.payout == b.payout &&
+    a.penetration == b.penetration &&
+    a.burn_cards == b.burn_cards &&
+    a.surrender == b.surrender &&
+    a.infinite_deck == b.infinite_deck;
+}
@@ -0,0 +1,277 @@
+#include "blackjack.h"
+#include <cstring>
+#include <memory>
+
+static const char HAND_LOG_MAGIC[8] = {'B', 'J', 'H', 'A', 'N', 'D', 'S', '1'};
+static const std::uint32_t HAND_LOG_BYTE_ORDER = 0x01020304;
+
+// Create the file with a header of zero records; finish() fills in the
+// count once every record is written.
+HandLogWriter::HandLogWriter(const std::string& path, const BlackjackRules& rules)
+  : path(path), file(path.c_str(), std::ios::binary | std::ios::trunc) {
+  if (!file) Rcpp::stop("cannot write hand log " + path);
+
+  std::memset(&header, 0, sizeof(header));
+  std::memcpy(header.magic, HAND_LOG_MAGIC, sizeof(HAND_LOG_MAGIC));
+  header.version = HAND_LOG_VERSION;
+  header.byte_order = HAND_LOG_BYTE_ORDER;
+  header.record_size = sizeof(HandRecord);
+  header.num_decks = static_cast<std::uint32_t>(rules.num_decks);
+  header.dealer_stands_soft_17 = rules.dealer_stands_soft_17 ? 1 : 0;
+  header.count = 0;
+  file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+
+  buffer.reserve(HAND_LOG_BUFFER);
+}
+
+// Append the buffered records. A failed stream stays failed, so the error
+// surfaces in finish().
+void HandLogWriter::flush() {
+  file.write(reinterpret_cast<const char*>(buffer.data()),
+             static_cast<std::streamsize>(buffer.size() * sizeof(HandRecord)));
+  header.count += buffer.size();
+  buffer.clear();
+}
+
+void HandLogWriter::finish() {
+  flush();
+  file.seekp(0);
+  file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+  file.close();
+  if (file.fail()) Rcpp::stop("error writing hand log " + path);
+}
+
+// Map a hand log file and check its header.
+HandLog::HandLog(const std::string& path)
+  : file(path, "hand log"), head(nullptr), records(nullptr) {
+  const unsigned char* data = file.data();
+  std::size_t bytes = file.size();
+
+  head = reinterpret_cast<const HandLogHeader*>(data);
+  std::string problem;
+  if (bytes < sizeof(HandLogHeader) ||
+      std::memcmp(head->magic, HAND_LOG_MAGIC, sizeof(HAND_LOG_MAGIC)) != 0) {
+    problem = "is not a hand log";
+  } else if (head->byte_order != HAND_LOG_BYTE_ORDER) {
+    problem = "was written on a platform with a different byte order";
+  } else if (head->version != HAND_LOG_VERSION || head->record_size != sizeof(HandRecord)) {
+    problem = "has format version " + std::to_string(head->version) +
+      ", expected " + std::to_string(HAND_LOG_VERSION);
+  } else if (bytes != sizeof(HandLogHeader) + head->count * sizeof(HandRecord)) {
+    problem = "is truncated (was the run interrupted?)";
+  }
+  if (!problem.empty()) Rcpp::stop(path + " " + problem);
+
+  records = reinterpret_cast<const HandRecord*>(data + sizeof(HandLogHeader));
+}
+
+#ifndef BLACKJACK_STANDALONE
+// The hand logs of one run, read as a single sequence of records.
+//
+// Record i of the sequence is record i - first[f] of file f, for the last
+// file whose first[f] is at most i.
+struct HandLogSet {
+  std::vector<std::string> paths;
+  std::vector<std::unique_ptr<HandLog>> files;
+  std::vector<std::uint64_t> first;
+  std::uint64_t count;
+};
+
+// Chart letters of the Action codes, as used in strategy charts.
+static const char ACTION_LETTERS[5] = {'S', 'H', 'D', 'P', 'R'};
+
+// Memory-map the hand log files written by a simulation.
+//
+// Nothing is read until records are asked for, so opening costs the same
+// for any log size.
+//
+// Parameters:
+//   paths - Files to open, as returned in `hand_log` by the simulation;
+//           their records are read in this order.
+//
+// Returns:
+//   An external pointer to the open logs, for read_hand_log_rcpp and
+//   hand_log_info_rcpp. The files are unmapped when it is garbage
+//   collected.
+//
+// [[Rcpp::export]]
+SEXP open_hand_log_rcpp(Rcpp::CharacterVector paths) {
+  if (paths.size() == 0) Rcpp::stop("paths must name at least one hand log");
+  std::unique_ptr<HandLogSet> set(new HandLogSet());
+  set->count = 0;
+  for (int i = 0; i < paths.size(); ++i) {
+    std::string path = Rcpp::as<std::string>(paths[i]);
+    std::unique_ptr<HandLog> log(new HandLog(path));
+    const HandLogHeader& h = log->header();
+    if (i > 0) {
+      const HandLogHeader& h0 = set->files[0]->header();
+      if (h.num_decks != h0.num_decks ||
+          h.dealer_stands_soft_17 != h0.dealer_stands_soft_17) {
+        Rcpp::stop(path + " was written under different rules than " + set->paths[0]);
+      }
+    }
+    set->paths.push_back(path);
+    set->first.push_back(set->count);
+    set->count += log->size();
+    set->files.push_back(std::move(log));
+  }
+  return Rcpp::XPtr<HandLogSet>(set.release(), true);
+}
+
+// Describe open hand logs.
+//
+// Parameters:
+//   log_ptr - External pointer from open_hand_log_rcpp.
+//
+// Returns:
+//   A list with the files, the total number of records, and the deck count
+//   and soft 17 rule they were written under.
+//
+// [[Rcpp::export]]
+Rcpp::List hand_log_info_rcpp(SEXP log_ptr) {
+  Rcpp::XPtr<HandLogSet> log(log_ptr);
+  const HandLogHeader& h = log->files[0]->header();
+  Rcpp::CharacterVector paths(static_cast<int>(log->paths.size()));
+  for (std::size_t f = 0; f < log->paths.size(); ++f) paths[f] = log->paths[f];
+  return Rcpp::List::create(
+    Rcpp::Named("files")                 = paths,
+    Rcpp::Named("records")               = static_cast<double>(log->count),
+    Rcpp::Named("num_decks")             = static_cast<int>(h.num_decks),
+    Rcpp::Named("dealer_stands_soft_17") = h.dealer_stands_soft_17 != 0
+  );
+}
+
+// Card codes of a record as "10♥ 6♠ 4♦".
+static std::string record_cards(const HandRecord& r) {
+  std::string out;
+  int n = std::min<int>(r.n_cards, HAND_LOG_CARDS);
+  for (int i = 0; i < n; ++i) {
+    if (i > 0) out += ' ';
+    out += card_label(Card{r.cards[i]});
+  }
+  return out;
+}
+
+// Decisions of a record as chart letters, e.g. "HHS".
+static std::string record_actions(const HandRecord& r) {
+  std::string out;
+  int n = std::min<int>(r.n_actions, HAND_LOG_ACTIONS);
+  for (int i = 0; i < n; ++i) out += ACTION_LETTERS[r.actions[i]];
+  return out;
+}
+
+// Read a filtered slice of open hand logs.
+//
+// Records are scanned in order from `start` and the matching ones
+// collected until `max_rows` are found, so a large log can be paged
+// through without ever being held in R: pass the `next` attribute of one
+// slice as the `start` of the next.
+//
+// Parameters:
+//   log_ptr   - External pointer from open_hand_log_rcpp.
+//   start     - Index of the first record to scan, from 0.
+//   max_rows  - Largest number of rows to return.
+//   shoe_from - Keep hands from shoes with at least this index.
+//   shoe_to   - Keep hands from shoes with at most this index; negative
+//               for no limit.
+//   seat      - Keep hands of this seat (from 1); 0 keeps every seat.
+//   upcard    - Keep hands against this dealer upcard value (2-11); 0
+//               keeps every upcard.
+//   action    - Keep hands where this decision was taken ("S", "H", "D",
+//               "P" or "R"); "" keeps every hand.
+//
+// Returns:
+//   A data frame with one row per matching hand: its record index, shoe,
+//   round, seat, hand, cards, decisions, dealer upcard, final total and
+//   number of cards, natural / dealer blackjack / split flags, true-count
+//   bin (from 1) and net result. Attribute `next` is the index to resume
+//   scanning from, or NA once the end of the log is reached.
+//
+// [[Rcpp::export]]
+Rcpp::DataFrame read_hand_log_rcpp(SEXP log_ptr,
+                                   double start = 0,
+                                   int max_rows = 100000,
+                                   double shoe_from = 0,
+                                   double shoe_to = -1,
+                                   int seat = 0,
+                                   int upcard = 0,
+                                   std::string action = "") {
+  Rcpp::XPtr<HandLogSet> log(log_ptr);
+  if (start < 0) Rcpp::stop("start must be non-negative");
+  if (max_rows < 1) Rcpp::stop("max_rows must be at least 1");
+  int action_code = -1;
+  if (!action.empty()) {
+    for (int a = 0; a < 5; ++a) {
+      if (action.size() == 1 && action[0] == ACTION_LETTERS[a]) action_code = a;
+    }
+    if (action_code < 0) Rcpp::stop("action must be one of S, H, D, P or R");
+  }
+
+  // Scan once to find the matching records, then fill the columns
+  std::vector<std::uint64_t> rows;
+  std::uint64_t i = static_cast<std::uint64_t>(start);
+  std::size_t f = 0;
+  while (f + 1 < log->files.size() && log->first[f + 1] <= i) ++f;
+  for (; i < log->count && static_cast<int>(rows.size()) < max_rows; ++i) {
+    while (i - log->first[f] >= log->files[f]->size()) ++f;
+    const HandRecord& r = (*log->files[f])[i - log->first[f]];
+
+    if (r.shoe < shoe_from || (shoe_to >= 0 && r.shoe > shoe_to)) continue;
+    if (seat > 0 && r.seat != seat - 1) continue;
+    if (upcard > 0 && card_value(Card{r.upcard}) != upcard) continue;
+    if (action_code >= 0) {
+      int n = std::min<int>(r.n_actions, HAND_LOG_ACTIONS);
+      if (std::find(r.actions, r.actions + n, action_code) == r.actions + n) continue;
+    }
+    rows.push_back(i);
+  }
+
+  int n = static_cast<int>(rows.size());
+  Rcpp::NumericVector index(n), shoe(n), net(n);
+  Rcpp::IntegerVector round(n), seat_col(n), hand(n), dealer_total(n), dealer_cards(n);
+  Rcpp::IntegerVector bin(n);
+  Rcpp::CharacterVector cards(n), actions(n), upcard_col(n);
+  Rcpp::LogicalVector natural(n), dealer_blackjack(n), split(n);
+
+  f = 0;
+  for (int k = 0; k < n; ++k) {
+    while (rows[k] - log->first[f] >= log->files[f]->size()) ++f;
+    const HandRecord& r = (*log->files[f])[rows[k] - log->first[f]];
+    index[k] = static_cast<double>(rows[k]);
+    shoe[k] = static_cast<double>(r.shoe);
+    round[k] = static_cast<int>(r.round) + 1;
+    seat_col[k] = r.seat + 1;
+    hand[k] = r.hand + 1;
+    cards[k] = record_cards(r);
+    actions[k] = record_actions(r);
+    upcard_col[k] = card_label(Card{r.upcard});
+    dealer_total[k] = r.dealer_total;
+    dealer_cards[k] = r.dealer_cards;
+    natural[k] = (r.flags & HAND_LOG_NATURAL) != 0;
+    dealer_blackjack[k] = (r.flags & HAND_LOG_DEALER_BLACKJACK) != 0;
+    split[k] = (r.flags & HAND_LOG_SPLIT) != 0;
+    bin[k] = r.bin + 1;
+    net[k] = r.net;
+  }
+
+  Rcpp::DataFrame out = Rcpp::DataFrame::create(
+    Rcpp::Named("index")            = index,
+    Rcpp::Named("shoe")             = shoe,
+    Rcpp::Named("round")            = round,
+    Rcpp::Named("seat")             = seat_col,
+    Rcpp::Named("hand")             = hand,
+    Rcpp::Named("cards")            = cards,
+    Rcpp::Named("actions")          = actions,
+    Rcpp::Named("upcard")           = upcard_col,
+    Rcpp::Named("dealer_total")     = dealer_total,
+    Rcpp::Named("dealer_cards")     = dealer_cards,
+    Rcpp::Named("natural")          = natural,
+    Rcpp::Named("dealer_blackjack") = dealer_blackjack,
+    Rcpp::Named("split")            = split,
+    Rcpp::Named("tc_bin")           = bin,
+    Rcpp::Named("net")              = net,
+    Rcpp::Named("stringsAsFactors") = false);
+  out.attr("next") = i < log->count ? static_cast<double>(i) : NA_REAL;
+  return out;
+}
+#endif
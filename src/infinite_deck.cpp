@@ -0,0 +1,194 @@
+#include "blackjack.h"
+#include <cmath>
+
+// Infinite-deck EVs.
+//
+// With an infinite deck every draw has the same probabilities (1/13 per
+// value, 4/13 for tens), so dealer outcomes and the player's stand, hit and
+// double EVs depend only on the two hands. Every hand state is a hard total
+// (Aces counted as 1) and whether it holds an Ace; each draw strictly
+// increases the hard total, so the tables below are filled from hard 21
+// downwards by the compiler and a query is a single lookup.
+
+// Probability of drawing a card of value `v` (2-11).
+constexpr double infinite_p(int v) {
+  return v == 10 ? 4.0 / 13.0 : 1.0 / 13.0;
+}
+
+// Best total of a hand state.
+constexpr int state_total(int hard, bool ace) {
+  return ace && hard + 10 <= 21 ? hard + 10 : hard;
+}
+
+// Hard total after drawing a card of value `v`.
+constexpr int next_hard(int hard, int v) {
+  return hard + (v == 11 ? 1 : v);
+}
+
+// Precomputed infinite-deck EVs for one soft 17 rule. States are indexed
+// [hard total 0-21][holds an Ace].
+//
+// Fields:
+//   dealer - Dealer's final-outcome distribution from each dealer state,
+//            laid out like DealerDist::p.
+//   stand  - EV of standing on a player total (0-21) against each dealer
+//            state.
+//   hit    - EV of hitting, then playing on optimally, for each dealer and
+//            player state.
+//   dbl    - EV of doubling (one card, doubled bet) for each dealer and
+//            player state.
+struct InfiniteDeckTables {
+  double dealer[22][2][6];
+  double stand[22][2][22];
+  double hit[22][2][22][2];
+  double dbl[22][2][22][2];
+};
+
+constexpr InfiniteDeckTables make_infinite_deck_tables(bool s17) {
+  InfiniteDeckTables t{};
+
+  for (int hard = 21; hard >= 0; --hard) {
+    for (int ace = 0; ace <= 1; ++ace) {
+      double* dist = t.dealer[hard][ace];
+      int total = state_total(hard, ace != 0);
+      bool soft = ace != 0 && total != hard;
+      if (total > 17 || (total == 17 && (s17 || !soft))) {
+        dist[total - 17] = 1.0;
+        continue;
+      }
+      for (int v = 2; v <= 11; ++v) {
+        int next = next_hard(hard, v);
+        if (next > 21) {
+          dist[5] += infinite_p(v);
+        } else {
+          const double* sub = t.dealer[next][ace | (v == 11)];
+          for (int k = 0; k < 6; ++k) dist[k] += infinite_p(v) * sub[k];
+        }
+      }
+    }
+  }
+
+  for (int dh = 0; dh <= 21; ++dh) {
+    for (int da = 0; da <= 1; ++da) {
+      const double* dist = t.dealer[dh][da];
+      for (int player = 0; player <= 21; ++player) {
+        double ev = dist[5];
+        for (int k = 0; k < 5; ++k) {
+          if (17 + k < player) ev += dist[k];
+          else if (17 + k > player) ev -= dist[k];
+        }
+        t.stand[dh][da][player] = ev;
+      }
+
+      for (int ph = 21; ph >= 0; --ph) {
+        for (int pa = 0; pa <= 1; ++pa) {
+          double hit = 0.0;
+          double dbl = 0.0;
+          for (int v = 2; v <= 11; ++v) {
+            int next = next_hard(ph, v);
+            if (next > 21) {
+              hit -= infinite_p(v);
+              dbl -= 2.0 * infinite_p(v);
+              continue;
+            }
+            int next_ace = pa | (v == 11);
+            double stand = t.stand[dh][da][state_total(next, next_ace != 0)];
+            double again = t.hit[dh][da][next][next_ace];
+            hit += infinite_p(v) * (again > stand ? again : stand);
+            dbl += 2.0 * infinite_p(v) * stand;
+          }
+          t.hit[dh][da][ph][pa] = hit;
+          t.dbl[dh][da][ph][pa] = dbl;
+        }
+      }
+    }
+  }
+
+  return t;
+}
+
+// Tables for H17 (index 0) and S17 (index 1), built at compile time.
+static constexpr InfiniteDeckTables INFINITE_DECK[2] = {
+  make_infinite_deck_tables(false),
+  make_infinite_deck_tables(true)
+};
+
+// Infinite-deck distribution of the dealer's final outcome.
+//
+// Parameters:
+//   dealer_hand - Dealer's current hand.
+//   s17         - True if the dealer stands on soft 17.
+//
+DealerDist infinite_dealer_dist_c(const HandState& dealer_hand, bool s17) {
+  DealerDist dist;
+  dist.p.fill(0.0);
+  if (dealer_hand.hard_total > 21) {
+    dist.p[5] = 1.0;
+    return dist;
+  }
+  const double* p = INFINITE_DECK[s17].dealer[dealer_hand.hard_total][dealer_hand.aces > 0];
+  std::copy(p, p + 6, dist.p.begin());
+  return dist;
+}
+
+// Infinite-deck EV of standing on `player_total` against `dealer_hand`.
+double infinite_stand_ev_c(const HandState& dealer_hand, int player_total, bool s17) {
+  if (player_total > 21) return -1.0;
+  if (dealer_hand.hard_total > 21) return 1.0;
+  return INFINITE_DECK[s17].stand[dealer_hand.hard_total][dealer_hand.aces > 0][player_total];
+}
+
+// Infinite-deck EV of hitting `player_hand` and then playing optimally.
+double infinite_hit_ev_c(const HandState& dealer_hand, const HandState& player_hand,
+                         bool s17) {
+  if (player_hand.hard_total > 21) return -1.0;
+  if (dealer_hand.hard_total > 21) return 1.0;
+  return INFINITE_DECK[s17].hit[dealer_hand.hard_total][dealer_hand.aces > 0]
+    [player_hand.hard_total][player_hand.aces > 0];
+}
+
+// Infinite-deck EV of doubling `player_hand` (rules are not checked).
+double infinite_double_ev_c(const HandState& dealer_hand, const HandState& player_hand,
+                            bool s17) {
+  if (player_hand.hard_total > 21) return -2.0;
+  if (dealer_hand.hard_total > 21) return 2.0;
+  return INFINITE_DECK[s17].dbl[dealer_hand.hard_total][dealer_hand.aces > 0]
+    [player_hand.hard_total][player_hand.aces > 0];
+}
+
+// Infinite-deck EV of splitting a pair, without resplits. As for
+// eval_split_c, callers must check that the rules allow a split.
+//
+// Both hands are independent with an infinite deck, so the EV is twice
+// that of one hand started from a single `pair_value` card. Each hand
+// plays its best allowed action (standing only for split Aces that may not
+// be hit, doubling only if the rules allow it after a split).
+//
+// Parameters:
+//   dealer_hand - Dealer's current hand.
+//   pair_value  - Value of each card of the pair (2-11).
+//   rules       - Table rules.
+//
+double infinite_split_ev_c(const HandState& dealer_hand, int pair_value,
+                           const BlackjackRules& rules) {
+  if (rules.max_splits < 1) Rcpp::stop("the rules allow no splits (max_splits is 0)");
+  bool s17 = rules.dealer_stands_soft_17;
+  bool split_aces = (pair_value == 11);
+
+  double ev = 0.0;
+  for (int v = 2; v <= 11; ++v) {
+    HandState hand = empty_hand();
+    hand.add(pair_value);
+    hand.add(v);
+
+    double best = infinite_stand_ev_c(dealer_hand, hand.total(), s17);
+    if (!split_aces || rules.hit_split_aces) {
+      best = std::max(best, infinite_hit_ev_c(dealer_hand, hand, s17));
+      if (can_double_c(hand, rules, true)) {
+        best = std::max(best, infinite_double_ev_c(dealer_hand, hand, s17));
+      }
+    }
+    ev += infinite_p(v) * best;
+  }
+  return 2.0 * ev;
+}
@@ -0,0 +1,46 @@
+#include "blackjack.h"
+#include <fstream>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+MappedFile::MappedFile(const std::string& path, const std::string& what)
+  : start(nullptr), bytes(0), mapping(nullptr) {
+#ifndef _WIN32
+  int fd = open(path.c_str(), O_RDONLY);
+  if (fd < 0) Rcpp::stop("cannot open " + what + " " + path);
+  struct stat st;
+  if (fstat(fd, &st) != 0) {
+    close(fd);
+    Rcpp::stop("cannot read " + what + " " + path);
+  }
+  bytes = static_cast<std::size_t>(st.st_size);
+  // An empty file cannot be mapped; it is left at zero bytes
+  if (bytes > 0) {
+    mapping = mmap(nullptr, bytes, PROT_READ, MAP_SHARED, fd, 0);
+    if (mapping == MAP_FAILED) {
+      mapping = nullptr;
+      close(fd);
+      Rcpp::stop("cannot map " + what + " " + path);
+    }
+    start = static_cast<const unsigned char*>(mapping);
+  }
+  close(fd);
+#else
+  std::ifstream in(path.c_str(), std::ios::binary);
+  if (!in) Rcpp::stop("cannot open " + what + " " + path);
+  buffer.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+  bytes = buffer.size();
+  start = buffer.data();
+#endif
+}
+
+MappedFile::~MappedFile() {
+#ifndef _WIN32
+  if (mapping != nullptr) munmap(mapping, bytes);
+#endif
+}
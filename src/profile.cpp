@@ -0,0 +1,128 @@
+#include "blackjack.h"
+#include <mutex>
+
+#ifdef BLACKJACK_PROFILE
+// Registry of per-thread profile data.
+//
+// Live threads are summed when read; a thread's totals move into `retired`
+// when it exits, so counts from finished simulation workers are kept.
+static std::mutex profile_mutex;
+static std::vector<ProfileData*> live_threads;
+static ProfileData retired;
+
+// One thread's profile data, registered for its lifetime.
+struct ProfileSlot {
+  ProfileData data;
+
+  ProfileSlot() {
+    data = ProfileData();
+    std::lock_guard<std::mutex> lock(profile_mutex);
+    live_threads.push_back(&data);
+  }
+
+  ~ProfileSlot() {
+    std::lock_guard<std::mutex> lock(profile_mutex);
+    for (int i = 0; i < NUM_PROFILE_COUNTERS; ++i) retired.counts[i] += data.counts[i];
+    for (int i = 0; i < NUM_PROFILE_TIMERS; ++i) {
+      retired.timer_calls[i] += data.timer_calls[i];
+      retired.timer_ns[i] += data.timer_ns[i];
+    }
+    live_threads.erase(std::find(live_threads.begin(), live_threads.end(), &data));
+  }
+};
+
+ProfileData& profile_local() {
+  thread_local ProfileSlot slot;
+  return slot.data;
+}
+
+// Sum the profile data of every thread, live or finished.
+//
+// Call between computations, when no worker is counting.
+//
+// Parameters:
+//   reset - If true, zero every thread's data after reading it.
+//
+ProfileData profile_totals(bool reset) {
+  ProfileData total = ProfileData();
+  std::lock_guard<std::mutex> lock(profile_mutex);
+  std::vector<ProfileData*> sources(live_threads);
+  sources.push_back(&retired);
+  for (ProfileData* data : sources) {
+    for (int i = 0; i < NUM_PROFILE_COUNTERS; ++i) total.counts[i] += data->counts[i];
+    for (int i = 0; i < NUM_PROFILE_TIMERS; ++i) {
+      total.timer_calls[i] += data->timer_calls[i];
+      total.timer_ns[i] += data->timer_ns[i];
+    }
+    if (reset) *data = ProfileData();
+  }
+  return total;
+}
+#endif
+
+#ifndef BLACKJACK_STANDALONE
+static const char* const COUNTER_NAMES[NUM_PROFILE_COUNTERS] = {
+  "ev_nodes", "ev_cache_hits", "dealer_nodes", "dealer_cache_hits",
+  "dealer_table_hits", "shoes_shuffled", "cards_drawn", "rounds_played"
+};
+
+static const char* const TIMER_NAMES[NUM_PROFILE_TIMERS] = {
+  "parse_rules", "parse_strategy", "df_to_cards", "shuffle", "ev_query",
+  "strategy_table", "simulate"
+};
+
+// Counters and timers accumulated since the last reset.
+//
+// Parameters:
+//   reset - If true, zero everything after reading.
+//
+// Returns:
+//   A data.frame with one row per counter and timer: name, kind
+//   ("counter" or "timer"), count (events, or timed calls) and seconds
+//   (NA for counters). Without BLACKJACK_PROFILE the data frame has no
+//   rows and its "enabled" attribute is FALSE.
+//
+// [[Rcpp::export]]
+Rcpp::DataFrame get_profile_rcpp(bool reset = false) {
+#ifdef BLACKJACK_PROFILE
+  const bool enabled = true;
+  const int n = NUM_PROFILE_COUNTERS + NUM_PROFILE_TIMERS;
+  ProfileData total = profile_totals(reset);
+#else
+  (void)reset;
+  const bool enabled = false;
+  const int n = 0;
+#endif
+
+  Rcpp::CharacterVector names(n);
+  Rcpp::CharacterVector kinds(n);
+  Rcpp::NumericVector counts(n);
+  Rcpp::NumericVector seconds(n);
+#ifdef BLACKJACK_PROFILE
+  for (int i = 0; i < NUM_PROFILE_COUNTERS; ++i) {
+    names[i] = COUNTER_NAMES[i];
+    kinds[i] = "counter";
+    counts[i] = static_cast<double>(total.counts[i]);
+    seconds[i] = NA_REAL;
+  }
+  for (int i = 0; i < NUM_PROFILE_TIMERS; ++i) {
+    int row = NUM_PROFILE_COUNTERS + i;
+    names[row] = TIMER_NAMES[i];
+    kinds[row] = "timer";
+    counts[row] = static_cast<double>(total.timer_calls[i]);
+    seconds[row] = static_cast<double>(total.timer_ns[i]) * 1e-9;
+  }
+#else
+  (void)COUNTER_NAMES;
+  (void)TIMER_NAMES;
+#endif
+
+  Rcpp::DataFrame out = Rcpp::DataFrame::create(Rcpp::Named("name") = names,
+                                                Rcpp::Named("kind") = kinds,
+                                                Rcpp::Named("count") = counts,
+                                                Rcpp::Named("seconds") = seconds,
+                                                Rcpp::Named("stringsAsFactors") = false);
+  out.attr("enabled") = enabled;
+  return out;
+}
+#endif
@@ -1,39 +1,26 @@
-#include <Rcpp.h>
 #include <random>
 #include <algorithm>
+#include <cmath>
 #include "blackjack.h"
-using namespace Rcpp;
 
 // Create and shuffle a multi-deck blackjack shoe.
 //
 // Builds a complete shoe consisting of `num_decks` standard 52-card decks.
-// Each card stores a rank, suit, and blackjack
+// Each card is a one-byte code holding its rank and suit; the blackjack
 // point value (Ace = 11, face cards = 10, numeric cards use their face
-// values). Cards are generated in deterministic order and the shoe is
-// shuffled using the RNG passed in by reference.
+// values) is derived from the rank. Cards are generated in deterministic
+// order and the shoe is shuffled using the RNG passed in by reference.
 //
 std::vector<Card> create_shoe_c(int num_decks, std::mt19937_64& rng) {
-  // Suits, ranks, and blackjack point values
-  static const std::vector<std::string> suits  = {"♠", "♥", "♦", "♣"};
-  static const std::vector<std::string> ranks  = {"A", "J", "Q", "K",
-                                                  "2", "3", "4", "5", "6",
-                                                  "7", "8", "9", "10"};
-  static const std::vector<int> values         = {11, 10, 10, 10,   // A, J, Q, K
-                                                  2, 3, 4, 5, 6,
-                                                  7, 8, 9, 10};      // 2–10
-
   // Preallocate full shoe (52 cards per deck)
   std::vector<Card> shoe;
   shoe.reserve(52 * num_decks);
 
   // Build the shoe
   for (int d = 0; d < num_decks; ++d) {
-    for (std::size_t r = 0; r < ranks.size(); ++r) {
-      const std::string& rank = ranks[r];
-      int value = values[r];
-
-      for (const auto& suit : suits) {
-        shoe.push_back(Card{rank, suit, value});
+    for (int rank = 0; rank < 13; ++rank) {
+      for (int suit = 0; suit < 4; ++suit) {
+        shoe.push_back(make_card(rank, suit));
       }
     }
   }
@@ -44,3 +31,162 @@ std::vector<Card> create_shoe_c(int num_decks, std::mt19937_64& rng) {
   return shoe;
 }
 
+// Build an unshuffled shoe that can be reshuffled and dealt repeatedly.
+//
+// Parameters:
+//   num_decks   - Number of 52-card decks in the shoe.
+//   penetration - Fraction of the shoe dealt before the cut card.
+//
+Shoe::Shoe(int num_decks, double penetration)
+  : rng(0, 0), pos(0), exhausted_(false) {
+  ordered.reserve(52 * num_decks);
+  for (int d = 0; d < num_decks; ++d) {
+    for (int rank = 0; rank < 13; ++rank) {
+      for (int suit = 0; suit < 4; ++suit) {
+        ordered.push_back(make_card(rank, suit));
+      }
+    }
+  }
+  cards = ordered;
+  full_counts = full_shoe_counts(num_decks);
+  card_counts = full_counts;
+  cut = static_cast<std::size_t>(penetration * ordered.size());
+}
+
+// Reset to the unshuffled order and reseed for shoe `shoe_index`.
+//
+// Restoring the starting order (a copy into existing storage) keeps each
+// shoe a pure function of (seed, shoe_index) instead of depending on how
+// the previous shoe was dealt.
+void Shoe::shuffle(std::uint64_t seed, std::uint64_t shoe_index) {
+  PROFILE_SCOPE(SHUFFLE);
+  PROFILE_COUNT(SHOES_SHUFFLED);
+  std::copy(ordered.begin(), ordered.end(), cards.begin());
+  card_counts = full_counts;
+  rng = PhiloxRng(seed, shoe_index);
+  pos = 0;
+  exhausted_ = false;
+}
+
+// Hi-Lo running count of the seen cards divided by the decks left unseen.
+//
+// 2-6 count +1 and tens and Aces -1 as they are dealt. Burned cards are
+// still in the remaining counts, so they count as undealt, as they do for
+// a player estimating the discard tray.
+double Shoe::true_count() const {
+  int running = 0;
+  int remaining = 0;
+  for (int v = 2; v <= 11; ++v) {
+    int seen = full_counts[v] - card_counts[v];
+    if (v <= 6) running += seen;
+    else if (v >= 10) running -= seen;
+    remaining += card_counts[v];
+  }
+  if (remaining == 0) return 0.0;
+  return running / (remaining / 52.0);
+}
+
+// Create shoe number `shoe_index` of a counter-based sequence.
+//
+// Deals every card of a Shoe, so the result is exactly the order in which
+// the simulator deals that shoe. It depends only on (num_decks, seed,
+// shoe_index) and is the same on every platform, unlike std::shuffle whose
+// algorithm is left to the standard library.
+//
+// Parameters:
+//   num_decks  - Number of 52-card decks in the shoe.
+//   seed       - Base seed of the sequence.
+//   shoe_index - Which shoe of the sequence to build (0-based).
+//
+// Returns:
+//   The shuffled shoe.
+//
+std::vector<Card> create_shoe_at_c(int num_decks, std::uint64_t seed,
+                                   std::uint64_t shoe_index) {
+  Shoe shoe(num_decks, 1.0);
+  shoe.shuffle(seed, shoe_index);
+
+  std::vector<Card> cards;
+  cards.reserve(shoe.size());
+  for (int i = 0; i < shoe.size(); ++i) cards.push_back(shoe.draw());
+
+  return cards;
+}
+
+#ifndef BLACKJACK_STANDALONE
+// Fetch a single shoe of a simulation's counter-based shoe sequence.
+//
+// Parameters:
+//   rules_obj  - R list representing a blackjack_rules object.
+//   seed       - Base seed passed to simulate_rcpp.
+//   shoe_index - Which shoe to build (0-based), as numbered by simulate_rcpp.
+//
+// Returns:
+//   A data.frame with columns rank, suit and value, in dealing order.
+//
+// [[Rcpp::export]]
+Rcpp::DataFrame get_shoe_rcpp(Rcpp::List rules_obj, double seed, double shoe_index) {
+  BlackjackRules rules = parse_rules(rules_obj);
+  if (shoe_index < 0) Rcpp::stop("shoe_index must be non-negative");
+
+  std::vector<Card> shoe = create_shoe_at_c(rules.num_decks,
+                                            static_cast<std::uint64_t>(seed),
+                                            static_cast<std::uint64_t>(shoe_index));
+  return cards_to_df(shoe);
+}
+#endif
+
+// Remaining shoe composition representative of a Hi-Lo true count.
+//
+// Neutral cards (7-9) are the full shoe's scaled down to `decks_left`
+// decks. The low (2-6) and high (tens and Aces) cards are split so the
+// remaining high cards outnumber the low ones by the running count
+// rc = round(tc * decks_left), which makes the Hi-Lo count of the cards
+// already dealt exactly rc. Low cards are spread evenly over 2-6 and high
+// cards 4:1 between tens and Aces, as in a full shoe. Counts are clamped
+// to what the full shoe holds, so extreme counts in a small shoe come out
+// closer to zero.
+//
+// Parameters:
+//   num_decks  - Number of decks in the full shoe.
+//   decks_left - Decks not yet dealt (0 < decks_left <= num_decks).
+//   tc         - Hi-Lo true count.
+//
+// Returns:
+//   Remaining card counts indexed by value (2-11).
+//
+std::array<int, 12> true_count_composition_c(int num_decks, double decks_left,
+                                             double tc) {
+  std::array<int, 12> full = full_shoe_counts(num_decks);
+  int rc = static_cast<int>(std::lround(tc * decks_left));
+  int low = static_cast<int>(std::lround(20.0 * decks_left - rc / 2.0));
+  low = std::min(20 * num_decks, std::max(0, low));
+  int high = std::min(20 * num_decks, std::max(0, low + rc));
+
+  std::array<int, 12> counts;
+  counts.fill(0);
+  for (int v = 2; v <= 6; ++v) counts[v] = low / 5 + (v - 2 < low % 5 ? 1 : 0);
+  for (int v = 7; v <= 9; ++v) {
+    counts[v] = static_cast<int>(std::lround(full[v] * decks_left / num_decks));
+  }
+  counts[11] = std::min(full[11], static_cast<int>(std::lround(high / 5.0)));
+  counts[10] = std::min(full[10], high - counts[11]);
+  return counts;
+}
+
+// Card counts for a freshly built shoe.
+//
+// Parameters:
+//   num_decks - Number of 52-card decks in the shoe.
+//
+// Returns:
+//   An array indexed by card value (2-11) holding the number of cards of
+//   that value; tens include J, Q and K.
+//
+std::array<int, 12> full_shoe_counts(int num_decks) {
+  std::array<int, 12> counts;
+  counts.fill(0);
+  for (int v = 2; v <= 11; ++v) counts[v] = 4 * num_decks;
+  counts[10] = 16 * num_decks;
+  return counts;
+}
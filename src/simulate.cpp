@@ -0,0 +1,967 @@
+#include "blackjack.h"
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <memory>
+#include <thread>
+
+// One player hand within a round.
+//
+// Fields:
+//   state       - The hand's cards.
+//   bet         - Amount wagered on the hand (doubled after a double down).
+//   split_hand  - True if the hand was created by splitting.
+//   split_aces  - True if the hand was created by splitting Aces.
+//   surrendered - True if the player surrendered the hand.
+struct PlayerHand {
+  HandState state;
+  double bet;
+  bool split_hand;
+  bool split_aces;
+  bool surrendered;
+};
+
+// Decide what the strategy does with a hand, falling back to a legal play.
+//
+// Parameters:
+//   strategy  - The player's strategy table.
+//   hand      - The hand being played.
+//   upcard    - Value of the dealer's upcard (2-11).
+//   num_hands - Number of hands the player currently holds.
+//   bin       - True-count bin of the round.
+//   rules     - Table rules.
+//
+// Returns:
+//   The action to take. Doubling and surrender fall back to the cell's
+//   fallback action (hitting unless the strategy says otherwise) when they
+//   are not allowed; a pair that can no longer be split is played by its
+//   total, and a split that is not allowed becomes a hit. A fallback is
+//   checked like any other action: one that is not allowed either becomes
+//   a hit.
+//
+template <class R>
+static Action choose_action(const Strategy& strategy, const PlayerHand& hand,
+                            int upcard, int num_hands, int bin,
+                            const BlackjackRules& rules) {
+  const HandState& state = hand.state;
+
+  if (state.total() >= 21) return Action::STAND;
+
+  bool can_split = state.pair && num_hands < rules.max_splits + 1 &&
+    (!hand.split_aces || rules.resplit_aces);
+  int row = hand_class_c(state, can_split);
+  std::uint8_t cell = strategy.cell(row, upcard, bin);
+  Action action = cell_action(cell);
+
+  // Resplitting Aces is allowed even when split Aces may not be hit
+  if (action == Action::SPLIT && can_split) return Action::SPLIT;
+  if (!R::can_hit(hand.split_aces)) return Action::STAND;
+
+  bool can_double = R::can_double(state, hand.split_hand);
+  bool can_surrender = rules.surrender != SurrenderRule::NONE && num_hands == 1 &&
+    state.num_cards == 2;
+
+  // The cell's fallback if it is allowed itself, otherwise a hit
+  auto fallback = [&]() {
+    Action next = cell_fallback(cell);
+    if (next == Action::SPLIT && !can_split) return Action::HIT;
+    if (next == Action::DOUBLE && !can_double) return Action::HIT;
+    if (next == Action::SURRENDER) return Action::HIT;
+    return next;
+  };
+
+  switch (action) {
+    case Action::SPLIT:
+      return Action::HIT;
+    case Action::DOUBLE:
+      return can_double ? Action::DOUBLE : fallback();
+    case Action::SURRENDER:
+      return can_surrender ? Action::SURRENDER : fallback();
+    default:
+      return action;
+  }
+}
+
+// Largest number of player seats at a table.
+const int MAX_SEATS = 7;
+
+// One player seat at the table.
+//
+// Fields:
+//   strategy - The seat's strategy table.
+//   bet      - The seat's base bet.
+struct Seat {
+  const Strategy* strategy;
+  double bet;
+};
+
+// Where play_round logs its hands: the calling thread's writer and the
+// round's place in the run.
+struct RoundLog {
+  HandLogWriter* writer;
+  std::uint64_t shoe;
+  std::uint32_t round;
+};
+
+// Append a card to a hand record, keeping the first HAND_LOG_CARDS.
+static void log_card(HandRecord& record, Card card) {
+  if (record.n_cards < HAND_LOG_CARDS) record.cards[record.n_cards] = card.code;
+  record.n_cards++;
+}
+
+// Append a decision to a hand record, keeping the first HAND_LOG_ACTIONS.
+static void log_action(HandRecord& record, Action action) {
+  if (record.n_actions < HAND_LOG_ACTIONS) {
+    record.actions[record.n_actions] = static_cast<std::uint8_t>(action);
+  }
+  record.n_actions++;
+}
+
+// Play one round of blackjack from the current shoe position.
+//
+// Every seat is dealt from the same shoe in table order: one card to each
+// seat, the dealer's upcard, a second card to each seat, then the hole
+// card. Seats play their hands in order and the dealer's hand is played
+// once for the whole table.
+//
+// Parameters:
+//   shoe    - The shoe to deal from.
+//   rules   - Table rules.
+//   seats   - The seats in play, in dealing order.
+//   n_seats - Number of seats (1 to MAX_SEATS).
+//   nets    - Set to each seat's net result for the round, in the same
+//             units as its bet.
+//   log     - Where to log the round's hands, or null.
+//
+// Returns:
+//   true if the round completed, false if the shoe ran out mid-round (the
+//   round is then discarded, and not logged).
+//
+template <class R>
+static bool play_round(Shoe& shoe, const BlackjackRules& rules,
+                       const Seat* seats, int n_seats, double* nets,
+                       const RoundLog* log) {
+  PROFILE_COUNT(ROUNDS_PLAYED);
+  PlayerHand hands[MAX_SEATS][MAX_HANDS];
+  HandRecord records[MAX_SEATS][MAX_HANDS];   // Only filled in when logging
+  int num_hands[MAX_SEATS];
+  int bins[MAX_SEATS];
+  bool settled[MAX_SEATS];
+  HandState dealer = empty_hand();
+
+  // Count-dependent strategies read the true count before the deal
+  for (int s = 0; s < n_seats; ++s) {
+    const Strategy& strategy = *seats[s].strategy;
+    bins[s] = strategy.n_bins > 1 ? strategy.bin(shoe.true_count()) : 0;
+    num_hands[s] = 1;
+    settled[s] = false;
+    hands[s][0] = PlayerHand{empty_hand(), seats[s].bet, false, false, false};
+    if (log) {
+      HandRecord& record = records[s][0];
+      std::memset(&record, 0, sizeof(record));
+      record.shoe = log->shoe;
+      record.round = log->round;
+      record.seat = static_cast<std::uint8_t>(s);
+      record.bin = bins[s];
+    }
+  }
+
+  // Deal a card to hand h of seat s
+  auto deal = [&](int s, int h) {
+    Card card = shoe.draw();
+    hands[s][h].state.add(card_value(card));
+    if (log) log_card(records[s][h], card);
+  };
+
+  // Fill in the dealer's hand and the seats' results, and write the
+  // round's records
+  Card upcard_card;
+  auto write_log = [&]() {
+    for (int s = 0; s < n_seats; ++s) {
+      if (settled[s]) records[s][0].net = nets[s];
+      for (int h = 0; h < num_hands[s]; ++h) {
+        HandRecord& record = records[s][h];
+        record.upcard = upcard_card.code;
+        record.dealer_total = static_cast<std::uint8_t>(dealer.total());
+        record.dealer_cards = static_cast<std::uint8_t>(dealer.num_cards);
+        if (dealer.blackjack()) record.flags |= HAND_LOG_DEALER_BLACKJACK;
+        log->writer->add(record);
+      }
+    }
+  };
+
+  // Deal each seat, the dealer, each seat again, the dealer
+  for (int s = 0; s < n_seats; ++s) deal(s, 0);
+  upcard_card = shoe.draw();
+  int upcard = card_value(upcard_card);
+  dealer.add(upcard);
+  for (int s = 0; s < n_seats; ++s) deal(s, 0);
+  dealer.add(card_value(shoe.draw()));
+  if (shoe.exhausted()) return false;
+  bool dealer_blackjack = dealer.blackjack();
+
+  for (int s = 0; s < n_seats; ++s) {
+    const Strategy& strategy = *seats[s].strategy;
+    double bet = seats[s].bet;
+    bool player_blackjack = hands[s][0].state.blackjack();
+    if (log && player_blackjack) records[s][0].flags |= HAND_LOG_NATURAL;
+
+    // Early surrender is decided before the dealer checks for blackjack
+    if (rules.surrender == SurrenderRule::EARLY && !player_blackjack &&
+        choose_action<R>(strategy, hands[s][0], upcard, 1, bins[s], rules) ==
+          Action::SURRENDER) {
+      nets[s] = -0.5 * bet;
+      settled[s] = true;
+      if (log) log_action(records[s][0], Action::SURRENDER);
+    }
+    // Dealer peeks: a dealer blackjack ends the round immediately
+    else if (rules.dealer_peeks && dealer_blackjack) {
+      nets[s] = player_blackjack ? 0.0 : -bet;
+      settled[s] = true;
+    }
+    // Player natural
+    else if (player_blackjack) {
+      nets[s] = dealer_blackjack ? 0.0 : rules.payout * bet;
+      settled[s] = true;
+    }
+  }
+  if (rules.dealer_peeks && dealer_blackjack) {
+    if (log) write_log();
+    return true;
+  }
+
+  // Each seat plays each of its hands in turn; splitting appends new
+  // hands to the end
+  for (int s = 0; s < n_seats; ++s) {
+    if (settled[s]) continue;
+    const Strategy& strategy = *seats[s].strategy;
+    PlayerHand* seat_hands = hands[s];
+
+    for (int h = 0; h < num_hands[s]; ++h) {
+      PlayerHand& hand = seat_hands[h];
+
+      // A hand created by a split receives its second card when reached
+      if (hand.state.num_cards == 1) deal(s, h);
+
+      bool done = false;
+      while (!done && !shoe.exhausted()) {
+        Action action = choose_action<R>(strategy, hand, upcard, num_hands[s],
+                                         bins[s], rules);
+        if (log) log_action(records[s][h], action);
+
+        switch (action) {
+          case Action::STAND:
+            done = true;
+            break;
+          case Action::HIT:
+            deal(s, h);
+            if (hand.state.total() > 21) done = true;
+            break;
+          case Action::DOUBLE:
+            hand.bet *= 2.0;
+            deal(s, h);
+            done = true;
+            break;
+          case Action::SPLIT: {
+            int value = hand.state.first_value;
+            bool aces = (value == 11);
+            hand.state = empty_hand();
+            hand.state.add(value);
+            hand.split_hand = true;
+            hand.split_aces = aces;
+
+            PlayerHand& other = seat_hands[num_hands[s]];
+            other = PlayerHand{empty_hand(), hand.bet, true, aces, false};
+            other.state.add(value);
+
+            // Each hand keeps one card of the pair
+            if (log) {
+              HandRecord& record = records[s][h];
+              HandRecord& other_record = records[s][num_hands[s]];
+              other_record = record;
+              other_record.hand = static_cast<std::uint8_t>(num_hands[s]);
+              other_record.cards[0] = record.cards[1];
+              other_record.n_cards = 1;
+              other_record.n_actions = 0;
+              other_record.flags |= HAND_LOG_SPLIT;
+              record.n_cards = 1;
+              record.flags |= HAND_LOG_SPLIT;
+            }
+            num_hands[s] += 1;
+
+            deal(s, h);
+            break;
+          }
+          case Action::SURRENDER:
+            hand.surrendered = true;
+            done = true;
+            break;
+        }
+      }
+    }
+  }
+  if (shoe.exhausted()) return false;
+
+  // The dealer only draws if some hand at the table is still live
+  bool any_live = false;
+  for (int s = 0; s < n_seats; ++s) {
+    if (settled[s]) continue;
+    for (int h = 0; h < num_hands[s]; ++h) {
+      const PlayerHand& hand = hands[s][h];
+      if (!hand.surrendered && hand.state.total() <= 21) any_live = true;
+    }
+  }
+  if (any_live && !dealer_blackjack) {
+    if (!dealer_play_c<R::dealer_stands_soft_17>(shoe, dealer)) return false;
+  }
+
+  // Settle every hand against the dealer
+  int dealer_total = dealer.total();
+  for (int s = 0; s < n_seats; ++s) {
+    if (settled[s]) continue;
+    double net = 0.0;
+    for (int h = 0; h < num_hands[s]; ++h) {
+      const PlayerHand& hand = hands[s][h];
+      int total = hand.state.total();
+      double hand_net = 0.0;
+
+      if (hand.surrendered) hand_net = -0.5 * hand.bet;
+      else if (total > 21) hand_net = -hand.bet;
+      else if (dealer_blackjack) hand_net = -hand.bet;  // Unpeeked dealer blackjack
+      else if (dealer_total > 21 || total > dealer_total) hand_net = hand.bet;
+      else if (total < dealer_total) hand_net = -hand.bet;
+      net += hand_net;
+      if (log) records[s][h].net = hand_net;
+    }
+    nets[s] = net;
+  }
+
+  if (log) write_log();
+  return true;
+}
+
+// Net result and number of rounds of one shoe.
+struct ShoeTotals {
+  double net;
+  long rounds;
+};
+
+// Play every round of one shoe, from shuffle to cut card, for a table.
+//
+// Parameters:
+//   shoe       - The calling thread's shoe, reshuffled in place.
+//   rules      - Table rules.
+//   seats      - The seats in play.
+//   n_seats    - Number of seats.
+//   seed       - Base seed of the shoe sequence.
+//   shoe_index - Which shoe of the sequence to play.
+//   stats      - One accumulator per seat; each seat's rounds and shoe
+//                totals are added to its own.
+//   totals     - Set to each seat's totals for the shoe.
+//   log        - The calling thread's hand log, or null.
+//
+template <class R>
+static void play_table_shoe(Shoe& shoe, const BlackjackRules& rules,
+                            const Seat* seats, int n_seats,
+                            std::uint64_t seed, std::uint64_t shoe_index,
+                            SimStats* stats, ShoeTotals* totals,
+                            HandLogWriter* log) {
+  shoe.shuffle(seed, shoe_index);
+
+  // Deal rounds until the cut card comes out, after burning the top cards
+  shoe.burn(rules.burn_cards);
+
+  for (int s = 0; s < n_seats; ++s) totals[s] = ShoeTotals{0.0, 0};
+  double nets[MAX_SEATS];
+  RoundLog round_log = RoundLog{log, shoe_index, 0};
+  while (!shoe.past_cut()) {
+    if (!play_round<R>(shoe, rules, seats, n_seats, nets, log ? &round_log : nullptr)) break;
+    round_log.round++;
+
+    for (int s = 0; s < n_seats; ++s) {
+      stats[s].add_round(nets[s]);
+      totals[s].net += nets[s];
+      totals[s].rounds += 1;
+    }
+  }
+
+  for (int s = 0; s < n_seats; ++s) stats[s].add_shoe(totals[s].net, totals[s].rounds);
+}
+
+// Play every round of one shoe for a single seat with a unit bet.
+//
+// Returns:
+//   The shoe's totals.
+//
+template <class R>
+static ShoeTotals play_shoe(Shoe& shoe, const BlackjackRules& rules,
+                            const Strategy& strategy,
+                            std::uint64_t seed, std::uint64_t shoe_index,
+                            SimStats& stats) {
+  Seat seat = Seat{&strategy, 1.0};
+  ShoeTotals totals;
+  play_table_shoe<R>(shoe, rules, &seat, 1, seed, shoe_index, &stats, &totals, nullptr);
+  return totals;
+}
+
+// A play_shoe instantiation, chosen at run time for one rule variant.
+typedef ShoeTotals (*PlayShoeFn)(Shoe&, const BlackjackRules&, const Strategy&,
+                                 std::uint64_t, std::uint64_t, SimStats&);
+
+// Shoes per unit of work handed to a thread. Each block is accumulated
+// sequentially by one thread.
+const int BLOCK_SHOES = 64;
+
+// Blocks per batch. Block statistics are held until the batch ends and
+// then merged in block order, which bounds memory while keeping the
+// merge order, and so every statistic, independent of the thread count.
+const int BATCH_BLOCKS = 256;
+
+// Blocks per batch and worker thread when playing to a precision target.
+// Convergence is checked after every block, so this only bounds the work
+// wasted on blocks played past the stopping point.
+const int TARGET_BATCH_BLOCKS = 4;
+
+// Whether every seat's shoe-clustered standard error is at most `stop_se`.
+static bool seats_converged(const SimStats* stats, int n_seats, double stop_se) {
+  for (int s = 0; s < n_seats; ++s) {
+    if (!(stats[s].se_clustered() <= stop_se)) return false;
+  }
+  return true;
+}
+
+// Play a range of shoes across worker threads and merge the results.
+//
+// Parameters:
+//   rules      - Table rules.
+//   seats      - The seats in play.
+//   n_seats    - Number of seats.
+//   seed       - Base seed of the shoe sequence.
+//   first_shoe - Index of the first shoe to play.
+//   n_shoes    - Number of shoes to play.
+//   n_threads  - Number of worker threads (at least 1).
+//   stats      - One accumulator per seat the batch is merged into.
+//   stop_se    - Precision target (see simulate_shoes); negative for none.
+//   logs       - Hand log of each worker thread; empty if not logging.
+//
+// Returns:
+//   true if the target was met, in which case blocks after the one that
+//   met it are not merged.
+//
+template <class R>
+static bool simulate_batch(const BlackjackRules& rules,
+                           const Seat* seats, int n_seats,
+                           std::uint64_t seed, std::uint64_t first_shoe,
+                           long n_shoes, int n_threads, SimStats* stats,
+                           double stop_se,
+                           const std::vector<HandLogWriter*>& logs) {
+  int n_blocks = static_cast<int>((n_shoes + BLOCK_SHOES - 1) / BLOCK_SHOES);
+  std::vector<SimStats> blocks(n_blocks * n_seats);
+  std::atomic<int> next_block(0);
+
+  auto worker = [&](int t) {
+    Shoe shoe(rules.num_decks, rules.penetration);
+    ShoeTotals totals[MAX_SEATS];
+    HandLogWriter* log = logs.empty() ? nullptr : logs[t];
+    for (int b = next_block.fetch_add(1); b < n_blocks; b = next_block.fetch_add(1)) {
+      long begin = static_cast<long>(b) * BLOCK_SHOES;
+      long end = std::min<long>(begin + BLOCK_SHOES, n_shoes);
+      for (long k = begin; k < end; ++k) {
+        play_table_shoe<R>(shoe, rules, seats, n_seats, seed, first_shoe + k,
+                           &blocks[b * n_seats], totals, log);
+      }
+    }
+  };
+
+  std::vector<std::thread> pool;
+  for (int t = 1; t < std::min(n_threads, n_blocks); ++t) pool.emplace_back(worker, t);
+  worker(0);
+  for (std::thread& thread : pool) thread.join();
+
+  // Merge in block order so the result does not depend on scheduling
+  for (int b = 0; b < n_blocks; ++b) {
+    for (int s = 0; s < n_seats; ++s) stats[s].merge(blocks[b * n_seats + s]);
+    if (stop_se >= 0 && seats_converged(stats, n_seats, stop_se)) return true;
+  }
+  return false;
+}
+
+// Play up to `n_shoes` shoes in batches.
+//
+// Parameters:
+//   stop_se - Stop after the first block of BLOCK_SHOES shoes at which
+//             every seat's shoe-clustered standard error is at most this;
+//             negative plays every shoe. Blocks are merged in order, so
+//             the stopping point does not depend on the thread count.
+//   logs    - Hand log of each worker thread; empty if not logging. With
+//             a target, shoes played past the stopping point are logged
+//             but not counted.
+//
+// Returns:
+//   The merged statistics of every round played, one entry per seat.
+//
+template <class R>
+static std::vector<SimStats> simulate_shoes(const BlackjackRules& rules,
+                                            const Seat* seats, int n_seats,
+                                            std::uint64_t seed,
+                                            std::uint64_t first_shoe,
+                                            long n_shoes, int n_threads,
+                                            double stop_se,
+                                            const std::vector<HandLogWriter*>& logs = {}) {
+  PROFILE_SCOPE(SIMULATE);
+  // Smaller batches with a target, so little is played past it
+  int batch_blocks = stop_se < 0 ? BATCH_BLOCKS
+    : std::min(BATCH_BLOCKS, TARGET_BATCH_BLOCKS * n_threads);
+  const long batch_shoes = static_cast<long>(BLOCK_SHOES) * batch_blocks;
+  std::vector<SimStats> stats(n_seats);
+  for (long done = 0; done < n_shoes; done += batch_shoes) {
+    if (simulate_batch<R>(rules, seats, n_seats, seed, first_shoe + done,
+                          std::min(batch_shoes, n_shoes - done), n_threads,
+                          stats.data(), stop_se, logs)) {
+      break;
+    }
+    Rcpp::checkUserInterrupt();
+  }
+  return stats;
+}
+
+// The hand logs of one simulation call, one file per worker thread.
+//
+// Worker t writes `path`.t (numbered from 0). Each shoe's hands go to one
+// file in the order they were played; which file depends on scheduling,
+// the records themselves do not.
+struct RunLogs {
+  std::vector<std::string> paths;
+  std::vector<std::unique_ptr<HandLogWriter>> files;
+  std::vector<HandLogWriter*> writers;   // Passed to simulate_shoes
+};
+
+// Create the hand logs of a run; none if `path` is empty.
+static RunLogs open_run_logs(const std::string& path, int n_threads,
+                             const BlackjackRules& rules) {
+  RunLogs logs;
+  if (path.empty()) return logs;
+  for (int t = 0; t < n_threads; ++t) {
+    logs.paths.push_back(path + "." + std::to_string(t));
+    logs.files.emplace_back(new HandLogWriter(logs.paths.back(), rules));
+    logs.writers.push_back(logs.files.back().get());
+  }
+  return logs;
+}
+
+// Complete the hand logs of a run.
+//
+// Returns:
+//   The files written, for open_hand_log_rcpp.
+//
+static Rcpp::CharacterVector finish_run_logs(RunLogs& logs) {
+  Rcpp::CharacterVector paths(static_cast<int>(logs.paths.size()));
+  for (std::size_t t = 0; t < logs.files.size(); ++t) {
+    logs.files[t]->finish();
+    paths[t] = logs.paths[t];
+  }
+  return paths;
+}
+
+// Convert accumulated statistics into the list returned to R.
+//
+// Parameters:
+//   stats      - Statistics of the run.
+//   conf_level - Confidence level of the reported intervals.
+//
+static Rcpp::List stats_to_list(const SimStats& stats, double conf_level) {
+  double n = static_cast<double>(stats.rounds);
+  double ev = stats.net / n;
+  double z = R::qnorm(0.5 + conf_level / 2.0, 0.0, 1.0, 1, 0);
+  double se = stats.se_independent();
+  double se_shoe = stats.se_clustered();
+
+  return Rcpp::List::create(
+    Rcpp::Named("shoes")      = static_cast<double>(stats.shoes),
+    Rcpp::Named("rounds")     = n,
+    Rcpp::Named("net")        = stats.net,
+    Rcpp::Named("ev")         = ev,
+    Rcpp::Named("variance")   = stats.variance(),
+    Rcpp::Named("win_rate")   = stats.wins / n,
+    Rcpp::Named("push_rate")  = stats.pushes / n,
+    Rcpp::Named("loss_rate")  = stats.losses / n,
+    Rcpp::Named("se")         = se,
+    Rcpp::Named("se_shoe")    = se_shoe,
+    Rcpp::Named("ci")         = Rcpp::NumericVector::create(ev - z * se, ev + z * se),
+    Rcpp::Named("ci_shoe")    = Rcpp::NumericVector::create(ev - z * se_shoe,
+                                                            ev + z * se_shoe),
+    Rcpp::Named("conf_level") = conf_level
+  );
+}
+
+// Simulate full shoes of blackjack across worker threads.
+//
+// Shoe k is a pure function of (seed, k) (see create_shoe_at_c), and shoe
+// statistics are merged in a fixed order, so results are bit-identical for
+// any number of threads. Because no generator state carries over between
+// shoes, a run can be split across processes by giving each one its own
+// range of shoes through `first_shoe`; get_shoe_rcpp rebuilds any single
+// shoe for inspection. Statistics are accumulated as the shoes are played,
+// so memory use does not grow with the number of rounds.
+//
+// Parameters:
+//   rules_obj  - R list representing a blackjack_rules object.
+//   strategy   - Integer matrix of action codes (see parse_strategy).
+//   n_shoes    - Number of shoes to play.
+//   n_threads  - Number of worker threads; 0 uses every available core.
+//   seed       - Base random seed.
+//   first_shoe - Index of the first shoe to play; shoes first_shoe through
+//                first_shoe + n_shoes - 1 are played.
+//   conf_level - Confidence level of the reported intervals.
+//   log_path   - If not empty, log every hand played to binary files
+//                `log_path`.0, `log_path`.1, ... (one per worker thread;
+//                see HandRecord), to be read with open_hand_log_rcpp.
+//
+// Returns:
+//   A list with the number of shoes and rounds, the total net result, the
+//   per-round EV, variance, and win/push/loss rates, and the standard error
+//   and confidence interval of the EV both treating rounds as independent
+//   (`se`, `ci`) and clustering rounds by shoe (`se_shoe`, `ci_shoe`).
+//   When logging, `hand_log` holds the files written.
+//
+// [[Rcpp::export]]
+Rcpp::List simulate_rcpp(Rcpp::List rules_obj,
+                         Rcpp::IntegerMatrix strategy,
+                         int n_shoes,
+                         int n_threads = 0,
+                         double seed = 1,
+                         double first_shoe = 0,
+                         double conf_level = 0.95,
+                         std::string log_path = "") {
+  BlackjackRules rules = parse_rules(rules_obj);
+  Strategy strategy_c = parse_strategy(strategy);
+  if (n_shoes < 1) Rcpp::stop("n_shoes must be at least 1");
+  if (first_shoe < 0) Rcpp::stop("first_shoe must be non-negative");
+  if (conf_level <= 0 || conf_level >= 1) Rcpp::stop("conf_level must be between 0 and 1");
+
+  if (n_threads <= 0) n_threads = std::max(1u, std::thread::hardware_concurrency());
+  std::uint64_t base_seed = static_cast<std::uint64_t>(seed);
+  std::uint64_t base_shoe = static_cast<std::uint64_t>(first_shoe);
+
+  RunLogs logs = open_run_logs(log_path, n_threads, rules);
+
+  // The rule set is fixed for the whole run, so its instantiation is
+  // chosen once here rather than tested inside every round
+  Seat seat = Seat{&strategy_c, 1.0};
+  SimStats stats = dispatch_rules(rules, [&](auto rule_set) {
+    return simulate_shoes<decltype(rule_set)>(rules, &seat, 1, base_seed,
+                                              base_shoe, n_shoes, n_threads, -1.0,
+                                              logs.writers);
+  })[0];
+
+  Rcpp::List out = stats_to_list(stats, conf_level);
+  if (!log_path.empty()) out["hand_log"] = finish_run_logs(logs);
+  return out;
+}
+
+// Simulate a full table of seats sharing one shoe.
+//
+// All seats are dealt from the same shoe each round and the dealer's hand
+// is resolved once for the table, so card consumption per round and the
+// number of rounds before the cut card reflect the table size. Statistics
+// are kept per seat in one pass; as in simulate_rcpp they are
+// bit-identical for any number of threads.
+//
+// Parameters:
+//   rules_obj  - R list representing a blackjack_rules object.
+//   strategies - List of integer strategy matrices (see parse_strategy),
+//                one per seat in dealing order (first base first).
+//   bets       - Base bet of each seat.
+//   n_shoes    - Number of shoes to play.
+//   n_threads  - Number of worker threads; 0 uses every available core.
+//   seed       - Base random seed.
+//   first_shoe - Index of the first shoe to play.
+//   conf_level - Confidence level of the reported intervals.
+//   log_path   - If not empty, log every hand played, as in simulate_rcpp.
+//
+// Returns:
+//   A data frame with one row per seat: its bet, rounds played, net result,
+//   EV per round in units of the seat's bet with its shoe-clustered
+//   standard error and confidence interval, and win/push/loss rates.
+//   When logging, attribute `hand_log` holds the files written.
+//
+// [[Rcpp::export]]
+Rcpp::DataFrame simulate_table_rcpp(Rcpp::List rules_obj,
+                                    Rcpp::List strategies,
+                                    Rcpp::NumericVector bets,
+                                    int n_shoes,
+                                    int n_threads = 0,
+                                    double seed = 1,
+                                    double first_shoe = 0,
+                                    double conf_level = 0.95,
+                                    std::string log_path = "") {
+  BlackjackRules rules = parse_rules(rules_obj);
+  int n_seats = strategies.size();
+  if (n_seats < 1 || n_seats > MAX_SEATS) {
+    Rcpp::stop("a table needs between 1 and %d seats", MAX_SEATS);
+  }
+  if (bets.size() != n_seats) Rcpp::stop("bets must have one entry per seat");
+  if (n_shoes < 1) Rcpp::stop("n_shoes must be at least 1");
+  if (first_shoe < 0) Rcpp::stop("first_shoe must be non-negative");
+  if (conf_level <= 0 || conf_level >= 1) Rcpp::stop("conf_level must be between 0 and 1");
+
+  std::vector<Strategy> strategy_c(n_seats);
+  std::vector<Seat> seats(n_seats);
+  for (int s = 0; s < n_seats; ++s) {
+    strategy_c[s] = parse_strategy(strategies[s]);
+    if (!(bets[s] > 0)) Rcpp::stop("bets must be positive");
+    seats[s] = Seat{&strategy_c[s], bets[s]};
+  }
+
+  if (n_threads <= 0) n_threads = std::max(1u, std::thread::hardware_concurrency());
+  std::uint64_t base_seed = static_cast<std::uint64_t>(seed);
+  std::uint64_t base_shoe = static_cast<std::uint64_t>(first_shoe);
+
+  RunLogs logs = open_run_logs(log_path, n_threads, rules);
+  std::vector<SimStats> stats = dispatch_rules(rules, [&](auto rule_set) {
+    return simulate_shoes<decltype(rule_set)>(rules, seats.data(), n_seats,
+                                              base_seed, base_shoe, n_shoes,
+                                              n_threads, -1.0, logs.writers);
+  });
+
+  double z = R::qnorm(0.5 + conf_level / 2.0, 0.0, 1.0, 1, 0);
+  Rcpp::IntegerVector seat(n_seats);
+  Rcpp::NumericVector rounds(n_seats), net(n_seats), ev(n_seats), se_shoe(n_seats);
+  Rcpp::NumericVector ci_lower(n_seats), ci_upper(n_seats);
+  Rcpp::NumericVector win_rate(n_seats), push_rate(n_seats), loss_rate(n_seats);
+
+  for (int s = 0; s < n_seats; ++s) {
+    const SimStats& st = stats[s];
+    double n = static_cast<double>(st.rounds);
+    seat[s] = s + 1;
+    rounds[s] = n;
+    net[s] = st.net;
+    ev[s] = st.net / n / bets[s];
+    se_shoe[s] = st.se_clustered() / bets[s];
+    ci_lower[s] = ev[s] - z * se_shoe[s];
+    ci_upper[s] = ev[s] + z * se_shoe[s];
+    win_rate[s] = st.wins / n;
+    push_rate[s] = st.pushes / n;
+    loss_rate[s] = st.losses / n;
+  }
+
+  Rcpp::DataFrame out = Rcpp::DataFrame::create(
+    Rcpp::Named("seat")      = seat,
+    Rcpp::Named("bet")       = bets,
+    Rcpp::Named("rounds")    = rounds,
+    Rcpp::Named("net")       = net,
+    Rcpp::Named("ev")        = ev,
+    Rcpp::Named("se_shoe")   = se_shoe,
+    Rcpp::Named("ci_lower")  = ci_lower,
+    Rcpp::Named("ci_upper")  = ci_upper,
+    Rcpp::Named("win_rate")  = win_rate,
+    Rcpp::Named("push_rate") = push_rate,
+    Rcpp::Named("loss_rate") = loss_rate);
+  if (!log_path.empty()) out.attr("hand_log") = finish_run_logs(logs);
+  return out;
+}
+
+// Simulate until the EV is known to a target precision.
+//
+// Shoes are played in the same fixed blocks as simulate_rcpp and the
+// shoe-clustered confidence interval is checked after each block of
+// BLOCK_SHOES shoes; the run stops at the first block where its
+// half-width is at most `half_width`, or when `max_shoes` have been
+// played. The stopping point depends only on the statistics, so it is the
+// same for any thread count, and the result equals that of simulate_rcpp
+// over the same shoes.
+//
+// Parameters:
+//   rules_obj  - R list representing a blackjack_rules object.
+//   strategy   - Integer matrix of action codes (see parse_strategy).
+//   half_width - Target half-width of the shoe-clustered CI of the EV, in
+//                units of the base bet (e.g. 0.001 for +/- 0.1%).
+//   max_shoes  - Upper bound on the number of shoes played.
+//   n_threads  - Number of worker threads; 0 uses every available core.
+//   seed       - Base random seed.
+//   first_shoe - Index of the first shoe to play.
+//   conf_level - Confidence level of the target interval.
+//
+// Returns:
+//   The list returned by simulate_rcpp, plus `half_width` (the achieved
+//   half-width of `ci_shoe`), `target` and `converged` (false if
+//   `max_shoes` ran out first).
+//
+// [[Rcpp::export]]
+Rcpp::List simulate_precision_rcpp(Rcpp::List rules_obj,
+                                   Rcpp::IntegerMatrix strategy,
+                                   double half_width,
+                                   double max_shoes = 1e8,
+                                   int n_threads = 0,
+                                   double seed = 1,
+                                   double first_shoe = 0,
+                                   double conf_level = 0.95) {
+  BlackjackRules rules = parse_rules(rules_obj);
+  Strategy strategy_c = parse_strategy(strategy);
+  if (!(half_width > 0)) Rcpp::stop("half_width must be positive");
+  if (max_shoes < 2) Rcpp::stop("max_shoes must be at least 2");
+  if (first_shoe < 0) Rcpp::stop("first_shoe must be non-negative");
+  if (conf_level <= 0 || conf_level >= 1) Rcpp::stop("conf_level must be between 0 and 1");
+
+  if (n_threads <= 0) n_threads = std::max(1u, std::thread::hardware_concurrency());
+  std::uint64_t base_seed = static_cast<std::uint64_t>(seed);
+  std::uint64_t base_shoe = static_cast<std::uint64_t>(first_shoe);
+  long limit = static_cast<long>(max_shoes);
+  double z = R::qnorm(0.5 + conf_level / 2.0, 0.0, 1.0, 1, 0);
+
+  Seat seat = Seat{&strategy_c, 1.0};
+  SimStats stats = dispatch_rules(rules, [&](auto rule_set) {
+    return simulate_shoes<decltype(rule_set)>(rules, &seat, 1, base_seed,
+                                              base_shoe, limit, n_threads,
+                                              half_width / z);
+  })[0];
+
+  double achieved = z * stats.se_clustered();
+  Rcpp::List out = stats_to_list(stats, conf_level);
+  out["half_width"] = achieved;
+  out["target"] = half_width;
+  out["converged"] = achieved <= half_width;
+  return out;
+}
+
+// Play the same shoes under several rule variants.
+//
+// Shoe k of every variant is dealt from the same counter-based stream
+// (seed, k), so variants with the same number of decks see exactly the
+// same cards and differences in their results come from the rules alone
+// (common random numbers). Paired standard errors of the differences to
+// the first variant are accumulated per shoe in PairedStats; because the
+// luck of the deal cancels, they are typically several times smaller than
+// those of independent runs, which the `se_diff_unpaired` column shows
+// for comparison. Variants with different decks still share seeds, but
+// the pairing then buys less.
+//
+// Parameters:
+//   rules_list - List of blackjack_rules objects; the first is the
+//                baseline.
+//   strategy   - Integer matrix of strategy cells (see parse_strategy),
+//                used for every variant.
+//   n_shoes    - Number of shoes to play under each variant.
+//   n_threads  - Number of worker threads; 0 uses every available core.
+//   seed       - Base random seed.
+//   first_shoe - Index of the first shoe to play.
+//   conf_level - Confidence level of the reported intervals.
+//
+// Returns:
+//   A data frame with one row per variant: rounds, ev, se_shoe, the
+//   difference in EV to the baseline (`diff`), its paired standard error
+//   (`se_diff`) and confidence interval (`ci_lower`, `ci_upper`), and the
+//   standard error the difference would have from independent runs.
+//
+// [[Rcpp::export]]
+Rcpp::DataFrame sweep_rules_rcpp(Rcpp::List rules_list,
+                                 Rcpp::IntegerMatrix strategy,
+                                 int n_shoes,
+                                 int n_threads = 0,
+                                 double seed = 1,
+                                 double first_shoe = 0,
+                                 double conf_level = 0.95) {
+  int n_variants = rules_list.size();
+  if (n_variants < 1) Rcpp::stop("rules_list must contain at least one rule set");
+  if (n_shoes < 2) Rcpp::stop("n_shoes must be at least 2");
+  if (first_shoe < 0) Rcpp::stop("first_shoe must be non-negative");
+  if (conf_level <= 0 || conf_level >= 1) Rcpp::stop("conf_level must be between 0 and 1");
+
+  std::vector<BlackjackRules> variants;
+  std::vector<PlayShoeFn> play;
+  for (int v = 0; v < n_variants; ++v) {
+    variants.push_back(parse_rules(rules_list[v]));
+    play.push_back(dispatch_rules(variants[v], [](auto rule_set) {
+      return static_cast<PlayShoeFn>(&play_shoe<decltype(rule_set)>);
+    }));
+  }
+  Strategy strategy_c = parse_strategy(strategy);
+
+  if (n_threads <= 0) n_threads = std::max(1u, std::thread::hardware_concurrency());
+  std::uint64_t base_seed = static_cast<std::uint64_t>(seed);
+  std::uint64_t base_shoe = static_cast<std::uint64_t>(first_shoe);
+
+  std::vector<SimStats> stats(n_variants);
+  std::vector<PairedStats> paired(n_variants);
+  const long batch_shoes = static_cast<long>(BLOCK_SHOES) * BATCH_BLOCKS;
+
+  for (long done = 0; done < n_shoes; done += batch_shoes) {
+    long batch = std::min<long>(batch_shoes, n_shoes - done);
+    int n_blocks = static_cast<int>((batch + BLOCK_SHOES - 1) / BLOCK_SHOES);
+    std::vector<SimStats> block_stats(n_blocks * n_variants);
+    std::vector<PairedStats> block_paired(n_blocks * n_variants);
+    std::atomic<int> next_block(0);
+
+    auto worker = [&]() {
+      std::vector<Shoe> shoes;
+      for (const BlackjackRules& rules : variants) {
+        shoes.emplace_back(rules.num_decks, rules.penetration);
+      }
+      std::vector<ShoeTotals> totals(n_variants);
+
+      for (int b = next_block.fetch_add(1); b < n_blocks; b = next_block.fetch_add(1)) {
+        long begin = static_cast<long>(b) * BLOCK_SHOES;
+        long end = std::min<long>(begin + BLOCK_SHOES, batch);
+        for (long k = begin; k < end; ++k) {
+          std::uint64_t shoe_index = base_shoe + done + k;
+          for (int v = 0; v < n_variants; ++v) {
+            totals[v] = play[v](shoes[v], variants[v], strategy_c, base_seed,
+                                shoe_index, block_stats[b * n_variants + v]);
+          }
+          for (int v = 1; v < n_variants; ++v) {
+            block_paired[b * n_variants + v].add_shoe(totals[0].net, totals[0].rounds,
+                                                      totals[v].net, totals[v].rounds);
+          }
+        }
+      }
+    };
+
+    std::vector<std::thread> pool;
+    for (int t = 1; t < std::min(n_threads, n_blocks); ++t) pool.emplace_back(worker);
+    worker();
+    for (std::thread& thread : pool) thread.join();
+
+    // Merge in block order so the result does not depend on scheduling
+    for (int b = 0; b < n_blocks; ++b) {
+      for (int v = 0; v < n_variants; ++v) {
+        stats[v].merge(block_stats[b * n_variants + v]);
+        paired[v].merge(block_paired[b * n_variants + v]);
+      }
+    }
+    Rcpp::checkUserInterrupt();
+  }
+
+  double z = R::qnorm(0.5 + conf_level / 2.0, 0.0, 1.0, 1, 0);
+  Rcpp::IntegerVector variant(n_variants);
+  Rcpp::NumericVector rounds(n_variants), ev(n_variants), se_shoe(n_variants);
+  Rcpp::NumericVector diff(n_variants), se_diff(n_variants);
+  Rcpp::NumericVector ci_lower(n_variants), ci_upper(n_variants), se_unpaired(n_variants);
+
+  for (int v = 0; v < n_variants; ++v) {
+    variant[v] = v + 1;
+    rounds[v] = static_cast<double>(stats[v].rounds);
+    ev[v] = stats[v].net / stats[v].rounds;
+    se_shoe[v] = stats[v].se_clustered();
+    if (v == 0) {
+      diff[v] = 0.0;
+      se_diff[v] = 0.0;
+      se_unpaired[v] = 0.0;
+    } else {
+      diff[v] = paired[v].difference();
+      se_diff[v] = paired[v].se_difference();
+      se_unpaired[v] = std::sqrt(se_shoe[0] * se_shoe[0] + se_shoe[v] * se_shoe[v]);
+    }
+    ci_lower[v] = diff[v] - z * se_diff[v];
+    ci_upper[v] = diff[v] + z * se_diff[v];
+  }
+
+  return Rcpp::DataFrame::create(Rcpp::Named("variant")          = variant,
+                                 Rcpp::Named("rounds")           = rounds,
+                                 Rcpp::Named("ev")               = ev,
+                                 Rcpp::Named("se_shoe")          = se_shoe,
+                                 Rcpp::Named("diff")             = diff,
+                                 Rcpp::Named("se_diff")          = se_diff,
+                                 Rcpp::Named("ci_lower")         = ci_lower,
+                                 Rcpp::Named("ci_upper")         = ci_upper,
+                                 Rcpp::Named("se_diff_unpaired") = se_unpaired);
+}
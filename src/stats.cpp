@@ -0,0 +1,150 @@
+#include "blackjack.h"
+#include <cmath>
+
+SimStats::SimStats()
+  : rounds(0), net(0.0), mean(0.0), m2(0.0), wins(0), pushes(0), losses(0),
+    shoes(0), shoe_net(0.0), shoe_rounds(0.0), c_net_net(0.0),
+    c_rounds_rounds(0.0), c_net_rounds(0.0) {}
+
+// Welford update with one round's result.
+void SimStats::add_round(double result) {
+  rounds += 1;
+  net += result;
+  double delta = result - mean;
+  mean += delta / rounds;
+  m2 += delta * (result - mean);
+
+  if (result > 0) wins += 1;
+  else if (result < 0) losses += 1;
+  else pushes += 1;
+}
+
+// Bivariate Welford update with one shoe's (net, rounds) pair.
+void SimStats::add_shoe(double shoe_net_result, long shoe_round_count) {
+  shoes += 1;
+  double d_net = shoe_net_result - shoe_net;
+  double d_rounds = shoe_round_count - shoe_rounds;
+  shoe_net += d_net / shoes;
+  shoe_rounds += d_rounds / shoes;
+  c_net_net += d_net * (shoe_net_result - shoe_net);
+  c_rounds_rounds += d_rounds * (shoe_round_count - shoe_rounds);
+  c_net_rounds += d_net * (shoe_round_count - shoe_rounds);
+}
+
+// Pairwise combination of two accumulators (Chan, Golub & LeVeque).
+void SimStats::merge(const SimStats& other) {
+  if (other.rounds > 0) {
+    double n_a = rounds, n_b = other.rounds, n = n_a + n_b;
+    double delta = other.mean - mean;
+    mean += delta * n_b / n;
+    m2 += other.m2 + delta * delta * n_a * n_b / n;
+    rounds += other.rounds;
+    net += other.net;
+    wins += other.wins;
+    pushes += other.pushes;
+    losses += other.losses;
+  }
+
+  if (other.shoes > 0) {
+    double g_a = shoes, g_b = other.shoes, g = g_a + g_b;
+    double d_net = other.shoe_net - shoe_net;
+    double d_rounds = other.shoe_rounds - shoe_rounds;
+    double w = g_a * g_b / g;
+    shoe_net += d_net * g_b / g;
+    shoe_rounds += d_rounds * g_b / g;
+    c_net_net += other.c_net_net + d_net * d_net * w;
+    c_rounds_rounds += other.c_rounds_rounds + d_rounds * d_rounds * w;
+    c_net_rounds += other.c_net_rounds + d_net * d_rounds * w;
+    shoes += other.shoes;
+  }
+}
+
+double SimStats::variance() const {
+  if (rounds < 2) return std::nan("");
+  return m2 / (rounds - 1);
+}
+
+double SimStats::se_independent() const {
+  return std::sqrt(variance() / rounds);
+}
+
+// Cluster-robust standard error of the ratio estimator net / rounds.
+//
+// With EV m = (mean shoe net) / (mean shoe rounds), the residual of shoe s
+// is net_s - m * rounds_s. The residuals sum to zero, so their sum of
+// squares is the co-moment expression below, and
+//
+//   Var(m) = G / (G - 1) * sum_s (net_s - m * rounds_s)^2 / N^2
+//
+// for G shoes and N rounds.
+double SimStats::se_clustered() const {
+  if (shoes < 2 || rounds == 0) return std::nan("");
+  double m = shoe_net / shoe_rounds;
+  double ss = c_net_net - 2.0 * m * c_net_rounds + m * m * c_rounds_rounds;
+  double g = static_cast<double>(shoes);
+  return std::sqrt(std::max(ss, 0.0) * g / (g - 1.0)) / rounds;
+}
+
+PairedStats::PairedStats() : shoes(0) {
+  mean.fill(0.0);
+  c.fill(0.0);
+}
+
+// Multivariate Welford update with one shoe's totals.
+void PairedStats::add_shoe(double net_a, long rounds_a, double net_b,
+                           long rounds_b) {
+  const std::array<double, 4> x = {net_a, static_cast<double>(rounds_a),
+                                   net_b, static_cast<double>(rounds_b)};
+  shoes += 1;
+  std::array<double, 4> d;
+  for (int i = 0; i < 4; ++i) {
+    d[i] = x[i] - mean[i];
+    mean[i] += d[i] / shoes;
+  }
+  for (int i = 0; i < 4; ++i) {
+    for (int j = 0; j < 4; ++j) c[i * 4 + j] += d[i] * (x[j] - mean[j]);
+  }
+}
+
+// Pairwise combination of two accumulators.
+void PairedStats::merge(const PairedStats& other) {
+  if (other.shoes == 0) return;
+  double g_a = shoes, g_b = other.shoes, g = g_a + g_b;
+  std::array<double, 4> d;
+  for (int i = 0; i < 4; ++i) {
+    d[i] = other.mean[i] - mean[i];
+    mean[i] += d[i] * g_b / g;
+  }
+  for (int i = 0; i < 4; ++i) {
+    for (int j = 0; j < 4; ++j) {
+      c[i * 4 + j] += other.c[i * 4 + j] + d[i] * d[j] * g_a * g_b / g;
+    }
+  }
+  shoes += other.shoes;
+}
+
+double PairedStats::difference() const {
+  return mean[2] / mean[3] - mean[0] / mean[1];
+}
+
+// With EVs m_a, m_b and total rounds N_a, N_b, shoe s has linearized
+// residual
+//
+//   e_s = (net_b,s - m_b rounds_b,s) / N_b - (net_a,s - m_a rounds_a,s) / N_a,
+//
+// which is a fixed linear combination `w` of the shoe's totals. The e_s
+// sum to zero, so sum_s e_s^2 = w' C w and
+// Var(m_b - m_a) = G / (G - 1) * w' C w for G shoes.
+double PairedStats::se_difference() const {
+  if (shoes < 2) return std::nan("");
+  double g = static_cast<double>(shoes);
+  double n_a = mean[1] * g, n_b = mean[3] * g;
+  double m_a = mean[0] / mean[1], m_b = mean[2] / mean[3];
+  const std::array<double, 4> w = {-1.0 / n_a, m_a / n_a, 1.0 / n_b, -m_b / n_b};
+
+  double ss = 0.0;
+  for (int i = 0; i < 4; ++i) {
+    for (int j = 0; j < 4; ++j) ss += w[i] * c[i * 4 + j] * w[j];
+  }
+  return std::sqrt(std::max(ss, 0.0) * g / (g - 1.0));
+}
@@ -0,0 +1,586 @@
+#include "blackjack.h"
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <thread>
+
+// Labels of the dealer upcards 2 through Ace, as used in row and column names.
+static const char* const UPCARD_LABELS[10] = {"2", "3", "4", "5", "6",
+                                              "7", "8", "9", "10", "A"};
+
+// Cards used to represent a strategy-table row when computing its EVs.
+//
+// Hard totals use two different non-Ace cards where possible (hard 4 is
+// 2-2, hard 20 is 10-10 and hard 21 needs three cards: 2-9-10), soft
+// totals are an Ace plus one card (soft 12 is A-A), and pairs are two
+// cards of the pair's value.
+//
+// Parameters:
+//   hand_class - A row index in [0, NUM_HAND_CLASSES).
+//
+// Returns:
+//   The card values making up the representative hand.
+//
+static std::vector<int> representative_cards(int hand_class) {
+  if (hand_class < 18) {
+    int total = hand_class + 4;
+    if (total == 4) return {2, 2};
+    if (total <= 12) return {2, total - 2};
+    if (total <= 19) return {total - 10, 10};
+    if (total == 20) return {10, 10};
+    return {2, 9, 10};
+  }
+  if (hand_class < 28) {
+    int total = hand_class - 18 + 12;
+    if (total == 12) return {11, 11};
+    return {11, total - 11};
+  }
+  int value = hand_class - 28 + 2;
+  return {value, value};
+}
+
+// Compute the EVs of one strategy-table cell.
+//
+// When the dealer peeks, the player only acts once a natural is ruled
+// out. This is approximated by conditioning the dealer's outcome at each
+// stand on not having a natural (see without_natural); the cards the
+// player draws still come from the unconditioned shoe, so the EVs against
+// an Ace or ten are close to, but not exactly, the conditioned ones. The
+// error is largest for one or two decks. Early surrender is decided before the peek, so its EV is restated
+// on the same footing: surrendering beats playing on exactly when -0.5
+// beats losing to a natural with probability p and otherwise earning the
+// conditioned EV, i.e. when that EV is below (p - 0.5) / (1 - p).
+//
+// Parameters:
+//   hand_class  - Row of the cell.
+//   upcard      - Dealer upcard value (2-11).
+//   card_counts - Shoe composition before the player's and dealer's cards
+//                 are removed.
+//   ctx         - Rules and caches of the calling worker; its
+//                 dealer_peeked flag must match the rules.
+//
+// Returns:
+//   The cell's EVs. Every EV is NaN if the shoe cannot supply the cards.
+//
+static CellEvs cell_evs(int hand_class, int upcard,
+                        const std::array<int, 12>& card_counts,
+                        EvContext& ctx) {
+  const double na = std::nan("");
+  CellEvs evs = CellEvs{na, na, na, na, na};
+
+  // Remove the representative hand and the upcard from the shoe
+  std::array<int, 12> counts = card_counts;
+  HandState player = empty_hand();
+  for (int v : representative_cards(hand_class)) {
+    player.add(v);
+    counts[v]--;
+  }
+  counts[upcard]--;
+  for (int v = 2; v <= 11; ++v) {
+    if (counts[v] < 0) return evs;
+  }
+
+  HandState dealer = empty_hand();
+  dealer.add(upcard);
+
+  evs.stand = eval_stand_c(dealer, player.total(), counts, ctx);
+  evs.hit = eval_hit_c(dealer, player, counts, ctx);
+  if (can_double_c(player, ctx.rules, false)) {
+    evs.dbl = eval_double_c(dealer, player, counts, ctx);
+  }
+  if (ctx.rules.surrender != SurrenderRule::NONE && player.num_cards == 2) {
+    double p_natural = ctx.dealer_peeked ? dealer_natural_prob(upcard, counts) : 0.0;
+    evs.surrender = ctx.rules.surrender == SurrenderRule::EARLY && p_natural < 1.0
+      ? (p_natural - 0.5) / (1.0 - p_natural)
+      : -0.5;
+  }
+  // Hard 4, hard 20 and soft 12 are dealt as pairs but are not pair rows
+  if (hand_class >= NUM_HAND_CLASSES - 10 && ctx.rules.max_splits >= 1) {
+    evs.split = eval_split_c(dealer, player.first_value, counts, ctx);
+  }
+
+  return evs;
+}
+
+// Compute action EVs for every hand class against every dealer upcard.
+//
+// Each worker thread takes whole upcard columns and keeps one EvContext
+// for everything it computes, so dealer distributions and hit/double
+// subtrees are shared between all hand classes of a column (and between
+// columns handled by the same worker). Cached values are exact, so the
+// table does not depend on the number of threads. Under peek rules the
+// EVs against an Ace or ten approximately assume the dealer has no
+// natural (see cell_evs).
+//
+// Parameters:
+//   rules       - Table rules.
+//   card_counts - Shoe composition before any cards are dealt.
+//   n_threads   - Number of worker threads (at least 1).
+//   cache_bytes - Memory budget of each worker's EvContext.
+//
+// Returns:
+//   NUM_HAND_CLASSES * 10 cells, cell `hand_class * 10 + (upcard - 2)`.
+//
+std::vector<CellEvs> strategy_table_c(const BlackjackRules& rules,
+                                      const std::array<int, 12>& card_counts,
+                                      int n_threads, std::size_t cache_bytes) {
+  PROFILE_SCOPE(STRATEGY_TABLE);
+  std::vector<CellEvs> cells(NUM_HAND_CLASSES * 10);
+  std::atomic<int> next_upcard(2);
+
+  auto worker = [&]() {
+    EvContext ctx(rules, cache_bytes);
+    ctx.dealer_peeked = rules.dealer_peeks;
+    for (int up = next_upcard.fetch_add(1); up <= 11; up = next_upcard.fetch_add(1)) {
+      for (int hand_class = 0; hand_class < NUM_HAND_CLASSES; ++hand_class) {
+        cells[hand_class * 10 + (up - 2)] = cell_evs(hand_class, up, card_counts, ctx);
+      }
+    }
+  };
+
+  std::vector<std::thread> pool;
+  for (int t = 1; t < std::min(n_threads, 10); ++t) pool.emplace_back(worker);
+  worker();
+  for (std::thread& thread : pool) thread.join();
+
+  return cells;
+}
+
+// Compute a full composition-dependent strategy table.
+//
+// Split EVs are filled in for the pair rows only. Under peek rules the
+// EVs against an Ace or ten approximately assume the dealer has no
+// natural: only the dealer's outcome is conditioned, not the player's
+// draws (see cell_evs).
+//
+// Parameters:
+//   rules_obj     - R list representing a blackjack_rules object.
+//   card_counts_r - Integer vector of remaining card counts by value
+//                   (length 12, indices 2-11 used as in get_specific_evs_rcpp).
+//   n_threads     - Number of worker threads; 0 uses every available core.
+//   cache_mb      - Memory budget per worker thread for the EV caches.
+//
+// Returns:
+//   A numeric matrix with one row per (hand class, upcard) cell, named like
+//   "H16_10" or "PA_6", and columns stand, hit, double, surrender and split.
+//   Rows are ordered hand class first, so row `hand_class * 10 + (upcard - 2)`
+//   lines up with the strategy matrix used by simulate_rcpp. Unavailable
+//   actions are NA.
+//
+// [[Rcpp::export]]
+Rcpp::NumericMatrix strategy_table_rcpp(Rcpp::List rules_obj,
+                                        Rcpp::IntegerVector card_counts_r,
+                                        int n_threads = 0,
+                                        double cache_mb = 64) {
+  BlackjackRules rules = parse_rules(rules_obj);
+  std::array<int, 12> card_counts;
+  for (int i = 0; i < 12; ++i) card_counts[i] = card_counts_r[i];
+
+  if (n_threads <= 0) n_threads = std::max(1u, std::thread::hardware_concurrency());
+  std::size_t cache_bytes = static_cast<std::size_t>(cache_mb * 1024 * 1024);
+
+  std::vector<CellEvs> cells = strategy_table_c(rules, card_counts, n_threads,
+                                                cache_bytes);
+
+  int n = static_cast<int>(cells.size());
+  Rcpp::NumericMatrix out(n, 5);
+  Rcpp::CharacterVector row_names(n);
+
+  for (int i = 0; i < n; ++i) {
+    const CellEvs& evs = cells[i];
+    out(i, 0) = std::isnan(evs.stand) ? NA_REAL : evs.stand;
+    out(i, 1) = std::isnan(evs.hit) ? NA_REAL : evs.hit;
+    out(i, 2) = std::isnan(evs.dbl) ? NA_REAL : evs.dbl;
+    out(i, 3) = std::isnan(evs.surrender) ? NA_REAL : evs.surrender;
+    out(i, 4) = std::isnan(evs.split) ? NA_REAL : evs.split;
+    row_names[i] = hand_class_label(i / 10) + "_" + UPCARD_LABELS[i % 10];
+  }
+
+  Rcpp::colnames(out) = Rcpp::CharacterVector::create("stand", "hit", "double",
+                                                      "surrender", "split");
+  Rcpp::rownames(out) = row_names;
+  return out;
+}
+
+// Chart codes accepted by compile_strategy_rcpp.
+//
+// Fields:
+//   name     - Code as written in a strategy chart.
+//   action   - Action to take.
+//   fallback - Action to take when `action` is not allowed.
+//   das_only - Split only if doubling after a split is allowed ("Ph").
+struct ChartCode {
+  const char* name;
+  Action action;
+  Action fallback;
+  bool das_only;
+};
+
+static const ChartCode CHART_CODES[] = {
+  {"S", Action::STAND, Action::STAND, false},
+  {"H", Action::HIT, Action::HIT, false},
+  {"D", Action::DOUBLE, Action::HIT, false},
+  {"Dh", Action::DOUBLE, Action::HIT, false},
+  {"Ds", Action::DOUBLE, Action::STAND, false},
+  {"P", Action::SPLIT, Action::HIT, false},
+  {"Ph", Action::SPLIT, Action::HIT, true},
+  {"R", Action::SURRENDER, Action::HIT, false},
+  {"Rh", Action::SURRENDER, Action::HIT, false},
+  {"Rs", Action::SURRENDER, Action::STAND, false},
+  {"Rp", Action::SURRENDER, Action::SPLIT, false},
+  {"stand", Action::STAND, Action::STAND, false},
+  {"hit", Action::HIT, Action::HIT, false},
+  {"double", Action::DOUBLE, Action::HIT, false},
+  {"split", Action::SPLIT, Action::HIT, false},
+  {"surrender", Action::SURRENDER, Action::HIT, false}
+};
+
+// Compile one chart code into a strategy cell for the given rules.
+//
+// Actions the rules never allow for the row (doubling a hand that can
+// never be doubled, surrender at a table without it, "Ph" without doubling
+// after splits) are replaced by their fallback here; the simulator still
+// applies the fallback for situations only known during play, such as
+// three-card hands or hands after a split.
+//
+// Parameters:
+//   hand_class - Row of the cell.
+//   upcard     - Dealer upcard value (2-11).
+//   name       - Chart code of the cell.
+//   rules      - Table rules.
+//
+// Returns:
+//   The encoded cell (see Strategy).
+//
+static std::uint8_t compile_cell(int hand_class, int upcard,
+                                 const std::string& name,
+                                 const BlackjackRules& rules) {
+  std::string where = hand_class_label(hand_class) + " vs " + UPCARD_LABELS[upcard - 2];
+
+  const ChartCode* code = nullptr;
+  for (const ChartCode& c : CHART_CODES) {
+    if (name == c.name) code = &c;
+  }
+  if (code == nullptr) Rcpp::stop("unknown action '" + name + "' for " + where);
+
+  Action action = code->action;
+  Action fallback = code->fallback;
+  if ((action == Action::SPLIT || fallback == Action::SPLIT) && hand_class < 28) {
+    Rcpp::stop("split is only allowed in pair rows (" + where + ")");
+  }
+
+  if (code->das_only && !rules.double_after_split) action = fallback;
+  if (action == Action::SURRENDER && rules.surrender == SurrenderRule::NONE) {
+    action = fallback;
+  }
+  if (action == Action::DOUBLE) {
+    HandState hand = empty_hand();
+    for (int v : representative_cards(hand_class)) hand.add(v);
+    if (!can_double_c(hand, rules, false)) action = fallback;
+  }
+
+  if (action == Action::DOUBLE || action == Action::SURRENDER) {
+    return make_cell(action, fallback);
+  }
+  return static_cast<std::uint8_t>(action);
+}
+
+// Find the strategy-table row of a hand label such as "H16", "S18" or
+// "PA", or -1 if there is none.
+static int hand_class_index(const std::string& label) {
+  for (int hand_class = 0; hand_class < NUM_HAND_CLASSES; ++hand_class) {
+    if (hand_class_label(hand_class) == label) return hand_class;
+  }
+  return -1;
+}
+
+// Find the upcard value (2-11) of a label such as "10" or "A", or -1.
+static int upcard_index(const std::string& label) {
+  for (int i = 0; i < 10; ++i) {
+    if (label == UPCARD_LABELS[i]) return i + 2;
+  }
+  return label == "11" ? 11 : -1;
+}
+
+// Compile a user strategy into the dense table used by simulate_rcpp.
+//
+// The simulator looks every decision up in this table in O(1), so a
+// strategy written in R never has to be called back during play.
+//
+// Parameters:
+//   rules_obj - R list representing a blackjack_rules object; actions the
+//               rules never allow are resolved to their fallback.
+//   strategy  - Either a character matrix of chart codes with
+//               NUM_HAND_CLASSES rows in strategy-table order (hard 4-21,
+//               soft 12-21, pairs 2-A) and 10 columns per true-count bin
+//               (upcards 2 through Ace), or a data frame with columns
+//               `hand` ("H16", "S18", "P8", "PA", ...), `upcard` ("2"-"10",
+//               "A", or values 2-11), `action` and, for count-dependent
+//               strategies, `tc_bin` (1-based). Every cell must be given
+//               exactly once. Codes are S, H, D (= Dh), Dh, Ds, P, Ph
+//               (split if doubling after splits is allowed, else hit),
+//               R (= Rh), Rh, Rs, Rp, or the action names used by
+//               get_specific_evs_rcpp.
+//   tc_breaks_r - Ascending Hi-Lo true counts separating the bins; bin b
+//                 covers [tc_breaks[b - 1], tc_breaks[b]). NULL for a
+//                 strategy that ignores the count.
+//
+// Returns:
+//   A NUM_HAND_CLASSES x (10 * bins) integer matrix of strategy cells
+//   (see parse_strategy) with a "tc_breaks" attribute when there is more
+//   than one bin.
+//
+// [[Rcpp::export]]
+Rcpp::IntegerMatrix compile_strategy_rcpp(Rcpp::List rules_obj,
+                                          Rcpp::RObject strategy,
+                                          Rcpp::Nullable<Rcpp::NumericVector> tc_breaks_r = R_NilValue) {
+  BlackjackRules rules = parse_rules(rules_obj);
+  Rcpp::NumericVector tc_breaks;
+  if (tc_breaks_r.isNotNull()) tc_breaks = Rcpp::NumericVector(tc_breaks_r);
+  int n_bins = tc_breaks.size() + 1;
+  int n_cells = NUM_HAND_CLASSES * 10 * n_bins;
+
+  Rcpp::IntegerMatrix out(NUM_HAND_CLASSES, 10 * n_bins);
+  std::vector<bool> seen(n_cells, false);
+
+  if (strategy.inherits("data.frame")) {
+    Rcpp::DataFrame df(strategy);
+    std::vector<std::string> hands = Rcpp::as<std::vector<std::string>>(df["hand"]);
+    std::vector<std::string> codes = Rcpp::as<std::vector<std::string>>(df["action"]);
+    std::vector<int> upcards(hands.size());
+    if (Rcpp::is<Rcpp::CharacterVector>(df["upcard"])) {
+      std::vector<std::string> labels = Rcpp::as<std::vector<std::string>>(df["upcard"]);
+      for (std::size_t i = 0; i < labels.size(); ++i) {
+        upcards[i] = upcard_index(labels[i]);
+        if (upcards[i] < 0) Rcpp::stop("unknown dealer upcard '" + labels[i] + "'");
+      }
+    } else {
+      upcards = Rcpp::as<std::vector<int>>(df["upcard"]);
+    }
+    std::vector<int> bins(hands.size(), 1);
+    if (df.containsElementNamed("tc_bin")) {
+      bins = Rcpp::as<std::vector<int>>(df["tc_bin"]);
+    } else if (n_bins > 1) {
+      Rcpp::stop("a strategy with tc_breaks needs a tc_bin column");
+    }
+
+    for (std::size_t i = 0; i < hands.size(); ++i) {
+      int hand_class = hand_class_index(hands[i]);
+      if (hand_class < 0) Rcpp::stop("unknown hand class '" + hands[i] + "'");
+      int upcard = upcards[i];
+      int bin = bins[i] - 1;
+      if (upcard < 2 || upcard > 11) Rcpp::stop("upcard values must be between 2 and 11");
+      if (bin < 0 || bin >= n_bins) Rcpp::stop("tc_bin must be between 1 and %d", n_bins);
+
+      int col = bin * 10 + (upcard - 2);
+      int index = col * NUM_HAND_CLASSES + hand_class;
+      if (seen[index]) {
+        Rcpp::stop("duplicate entry for " + hands[i] + " vs " + UPCARD_LABELS[upcard - 2]);
+      }
+      seen[index] = true;
+      out(hand_class, col) = compile_cell(hand_class, upcard, codes[i], rules);
+    }
+  } else if (Rcpp::is<Rcpp::CharacterMatrix>(strategy)) {
+    Rcpp::CharacterMatrix chart(strategy);
+    if (chart.nrow() != NUM_HAND_CLASSES || chart.ncol() != 10 * n_bins) {
+      Rcpp::stop("strategy must be a %d x %d character matrix", NUM_HAND_CLASSES,
+                 10 * n_bins);
+    }
+    for (int col = 0; col < 10 * n_bins; ++col) {
+      for (int hand_class = 0; hand_class < NUM_HAND_CLASSES; ++hand_class) {
+        std::string code = Rcpp::as<std::string>(chart(hand_class, col));
+        out(hand_class, col) = compile_cell(hand_class, col % 10 + 2, code, rules);
+        seen[col * NUM_HAND_CLASSES + hand_class] = true;
+      }
+    }
+  } else {
+    Rcpp::stop("strategy must be a data frame or a character matrix");
+  }
+
+  for (int index = 0; index < n_cells; ++index) {
+    if (!seen[index]) {
+      int col = index / NUM_HAND_CLASSES;
+      Rcpp::stop("strategy has no action for " +
+                 hand_class_label(index % NUM_HAND_CLASSES) + " vs " +
+                 UPCARD_LABELS[col % 10] + " (tc_bin " + std::to_string(col / 10 + 1) + ")");
+    }
+  }
+
+  Rcpp::CharacterVector row_names(NUM_HAND_CLASSES);
+  for (int hand_class = 0; hand_class < NUM_HAND_CLASSES; ++hand_class) {
+    row_names[hand_class] = hand_class_label(hand_class);
+  }
+  Rcpp::CharacterVector col_names(10 * n_bins);
+  for (int col = 0; col < 10 * n_bins; ++col) {
+    col_names[col] = n_bins > 1
+      ? "tc" + std::to_string(col / 10 + 1) + "_" + UPCARD_LABELS[col % 10]
+      : std::string(UPCARD_LABELS[col % 10]);
+  }
+  Rcpp::rownames(out) = row_names;
+  Rcpp::colnames(out) = col_names;
+  if (n_bins > 1) out.attr("tc_breaks") = tc_breaks;
+
+  // Validates the breaks and the encoding exactly as the simulator will
+  parse_strategy(out);
+  return out;
+}
+
+// Choose the highest-EV strategy cell from a cell's action EVs.
+//
+// Doubling and surrender fall back to the better of standing and hitting
+// (or splitting, for a surrendered pair), so the cell stays optimal among
+// the actions still allowed when the simulator cannot take the first
+// choice. A cell the composition cannot deal (all EVs NaN) stands on hard
+// 17 or more and hits otherwise.
+//
+// Parameters:
+//   hand_class - Row of the cell.
+//   evs        - EVs of the cell's actions; NaN for unavailable actions.
+//
+// Returns:
+//   The encoded cell (see Strategy).
+//
+static std::uint8_t best_cell(int hand_class, const CellEvs& evs) {
+  if (std::isnan(evs.stand)) {
+    return static_cast<std::uint8_t>(hand_class >= 13 && hand_class < 18 ? Action::STAND
+                                                                         : Action::HIT);
+  }
+
+  Action play = evs.hit > evs.stand ? Action::HIT : Action::STAND;
+  double play_ev = std::max(evs.stand, evs.hit);
+
+  Action best = play;
+  double best_ev = play_ev;
+  if (!std::isnan(evs.dbl) && evs.dbl > best_ev) {
+    best = Action::DOUBLE;
+    best_ev = evs.dbl;
+  }
+  bool pair_row = hand_class >= NUM_HAND_CLASSES - 10;
+  if (pair_row && !std::isnan(evs.split) && evs.split > best_ev) {
+    best = Action::SPLIT;
+    best_ev = evs.split;
+  }
+  if (!std::isnan(evs.surrender) && evs.surrender > best_ev) {
+    best = Action::SURRENDER;
+    best_ev = evs.surrender;
+  }
+
+  if (best == Action::DOUBLE) return make_cell(best, play);
+  if (best == Action::SURRENDER) {
+    Action fallback = play;
+    if (pair_row && !std::isnan(evs.split) && evs.split > play_ev) fallback = Action::SPLIT;
+    return make_cell(best, fallback);
+  }
+  return static_cast<std::uint8_t>(best);
+}
+
+// Build a count-indexed strategy from exact EVs at each true-count bin.
+//
+// Every bin is represented by one shoe composition (see
+// true_count_composition_c) at its representative true count, and the
+// full strategy table is computed for it; each cell then plays its
+// highest-EV action. The simulator picks the bin from the shoe's running
+// count and remaining decks before each round, so composition-aware play
+// costs one table lookup per decision.
+//
+// Parameters:
+//   rules_obj   - R list representing a blackjack_rules object.
+//   tc_breaks_r - Ascending Hi-Lo true counts separating the bins; bin b
+//                 covers [tc_breaks[b - 1], tc_breaks[b]).
+//   tc_points_r - True count representing each bin. NULL uses the midpoint
+//                 of each inner bin and one beyond the outer breaks.
+//   decks_left  - Decks remaining in the representative compositions; 0
+//                 uses the middle of the dealt part of the shoe,
+//                 num_decks * (1 - penetration / 2).
+//   n_threads   - Number of worker threads; 0 uses every available core.
+//   cache_mb    - Memory budget per worker thread for the EV caches.
+//
+// Returns:
+//   A NUM_HAND_CLASSES x (10 * bins) integer strategy matrix for
+//   simulate_rcpp, with attributes "tc_breaks", "tc_points",
+//   "decks_left" and "evs" (a numeric matrix of the action EVs with rows
+//   named like "tc2_H16_10", in the layout of strategy_table_rcpp).
+//
+// [[Rcpp::export]]
+Rcpp::IntegerMatrix count_strategy_rcpp(Rcpp::List rules_obj,
+                                        Rcpp::NumericVector tc_breaks_r,
+                                        Rcpp::Nullable<Rcpp::NumericVector> tc_points_r = R_NilValue,
+                                        double decks_left = 0,
+                                        int n_threads = 0,
+                                        double cache_mb = 64) {
+  BlackjackRules rules = parse_rules(rules_obj);
+  int n_bins = tc_breaks_r.size() + 1;
+  for (int i = 1; i < tc_breaks_r.size(); ++i) {
+    if (!(tc_breaks_r[i] > tc_breaks_r[i - 1])) Rcpp::stop("tc_breaks must be strictly increasing");
+  }
+
+  if (decks_left <= 0) decks_left = rules.num_decks * (1.0 - rules.penetration / 2.0);
+  if (decks_left > rules.num_decks) Rcpp::stop("decks_left cannot exceed num_decks");
+
+  Rcpp::NumericVector tc_points(n_bins);
+  if (tc_points_r.isNotNull()) {
+    tc_points = Rcpp::NumericVector(tc_points_r);
+    if (tc_points.size() != n_bins) Rcpp::stop("tc_points needs one true count per bin (%d)", n_bins);
+  } else if (n_bins == 1) {
+    tc_points[0] = 0.0;
+  } else {
+    for (int b = 0; b < n_bins; ++b) {
+      if (b == 0) tc_points[b] = tc_breaks_r[0] - 1.0;
+      else if (b == n_bins - 1) tc_points[b] = tc_breaks_r[b - 1] + 1.0;
+      else tc_points[b] = (tc_breaks_r[b - 1] + tc_breaks_r[b]) / 2.0;
+    }
+  }
+
+  if (n_threads <= 0) n_threads = std::max(1u, std::thread::hardware_concurrency());
+  std::size_t cache_bytes = static_cast<std::size_t>(cache_mb * 1024 * 1024);
+
+  const int cells_per_bin = NUM_HAND_CLASSES * 10;
+  Rcpp::IntegerMatrix out(NUM_HAND_CLASSES, 10 * n_bins);
+  Rcpp::NumericMatrix evs_out(cells_per_bin * n_bins, 5);
+  Rcpp::CharacterVector ev_names(cells_per_bin * n_bins);
+
+  for (int b = 0; b < n_bins; ++b) {
+    std::array<int, 12> counts = true_count_composition_c(rules.num_decks, decks_left,
+                                                          tc_points[b]);
+    std::vector<CellEvs> cells = strategy_table_c(rules, counts, n_threads, cache_bytes);
+
+    for (int i = 0; i < cells_per_bin; ++i) {
+      int hand_class = i / 10;
+      const CellEvs& evs = cells[i];
+      out(hand_class, b * 10 + i % 10) = best_cell(hand_class, evs);
+
+      int row = b * cells_per_bin + i;
+      evs_out(row, 0) = std::isnan(evs.stand) ? NA_REAL : evs.stand;
+      evs_out(row, 1) = std::isnan(evs.hit) ? NA_REAL : evs.hit;
+      evs_out(row, 2) = std::isnan(evs.dbl) ? NA_REAL : evs.dbl;
+      evs_out(row, 3) = std::isnan(evs.surrender) ? NA_REAL : evs.surrender;
+      evs_out(row, 4) = std::isnan(evs.split) ? NA_REAL : evs.split;
+      ev_names[row] = "tc" + std::to_string(b + 1) + "_" + hand_class_label(hand_class) +
+        "_" + UPCARD_LABELS[i % 10];
+    }
+    Rcpp::checkUserInterrupt();
+  }
+
+  Rcpp::CharacterVector row_names(NUM_HAND_CLASSES);
+  for (int hand_class = 0; hand_class < NUM_HAND_CLASSES; ++hand_class) {
+    row_names[hand_class] = hand_class_label(hand_class);
+  }
+  Rcpp::CharacterVector col_names(10 * n_bins);
+  for (int col = 0; col < 10 * n_bins; ++col) {
+    col_names[col] = "tc" + std::to_string(col / 10 + 1) + "_" + UPCARD_LABELS[col % 10];
+  }
+  Rcpp::rownames(out) = row_names;
+  Rcpp::colnames(out) = col_names;
+  Rcpp::colnames(evs_out) = Rcpp::CharacterVector::create("stand", "hit", "double",
+                                                          "surrender", "split");
+  Rcpp::rownames(evs_out) = ev_names;
+
+  if (n_bins > 1) out.attr("tc_breaks") = tc_breaks_r;
+  out.attr("tc_points") = tc_points;
+  out.attr("decks_left") = decks_left;
+  out.attr("evs") = evs_out;
+
+  // Validates the breaks and the encoding exactly as the simulator will
+  parse_strategy(out);
+  return out;
+}
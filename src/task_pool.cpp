@@ -0,0 +1,87 @@
+#include "blackjack.h"
+#include <deque>
+#include <exception>
+#include <mutex>
+#include <thread>
+
+// One worker's queue of task indices.
+//
+// The owner takes tasks from the back and thieves from the front, so a
+// worker keeps going through its own share in order while idle workers
+// take the tasks it would reach last.
+struct TaskQueue {
+  std::mutex mutex;
+  std::deque<std::size_t> tasks;
+
+  bool pop_back(std::size_t& task) {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (tasks.empty()) return false;
+    task = tasks.back();
+    tasks.pop_back();
+    return true;
+  }
+
+  bool pop_front(std::size_t& task) {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (tasks.empty()) return false;
+    task = tasks.front();
+    tasks.pop_front();
+    return true;
+  }
+};
+
+// Run independent tasks on a work-stealing pool.
+//
+// Tasks are dealt round-robin to one queue per worker, in the order
+// given, so list the most expensive tasks first. Each worker drains its
+// own queue and then steals from the others until every queue is empty.
+// A task is called as task(worker), with `worker` in [0, n_threads), so it
+// can use per-worker state such as an EvContext; which worker runs a
+// task varies from run to run, so tasks must not let their results depend
+// on it. The calling thread is worker 0. Tasks must not call the R API;
+// the first exception a task throws is rethrown here once all workers
+// have stopped.
+//
+// Parameters:
+//   tasks     - The tasks to run.
+//   n_threads - Number of workers, including the calling thread.
+//
+void run_tasks(const std::vector<std::function<void(int)>>& tasks, int n_threads) {
+  n_threads = std::max(1, std::min(n_threads, static_cast<int>(tasks.size())));
+
+  std::vector<TaskQueue> queues(n_threads);
+  for (std::size_t i = 0; i < tasks.size(); ++i) {
+    queues[i % n_threads].tasks.push_back(i);
+  }
+  // Owners pop from the back, so reverse each queue to start with its
+  // first (most expensive) task
+  for (TaskQueue& queue : queues) std::reverse(queue.tasks.begin(), queue.tasks.end());
+
+  std::mutex error_mutex;
+  std::exception_ptr error;
+
+  auto worker = [&](int id) {
+    std::size_t task;
+    for (;;) {
+      bool found = queues[id].pop_back(task);
+      for (int k = 1; !found && k < n_threads; ++k) {
+        found = queues[(id + k) % n_threads].pop_front(task);
+      }
+      if (!found) return;
+
+      try {
+        tasks[task](id);
+      } catch (...) {
+        std::lock_guard<std::mutex> lock(error_mutex);
+        if (!error) error = std::current_exception();
+      }
+    }
+  };
+
+  std::vector<std::thread> pool;
+  for (int t = 1; t < n_threads; ++t) pool.emplace_back(worker, t);
+  worker(0);
+  for (std::thread& thread : pool) thread.join();
+
+  if (error) std::rethrow_exception(error);
+}